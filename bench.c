@@ -0,0 +1,141 @@
+/**
+ * Yavalath AI benchmark
+ *
+ * Measures playouts per second from the empty board under different
+ * buffer allocation strategies. Each run gets a fresh buffer and the
+ * same seed, so the searches are identical and only memory placement
+ * differs. Optionally it then compares numbers of interleaved
+ * playouts in flight (see `yavalath_ai_set_inflight()`), which change
+ * the search itself as well as its speed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "yavalath.h"
+#include "os.h"
+
+#define BUFFER_MB   1024
+#define SECONDS     5.0
+#define SEED        0
+
+struct config {
+    const char *name;
+    int flags;                  // os_alloc() flags
+    int numa;                   // os_numa() node, or 0 to skip
+};
+
+static const struct config configs[] = {
+    {"default",          0,             0},
+    {"huge",             OS_ALLOC_HUGE, 0},
+    {"interleave",       0,             1},
+    {"huge+interleave",  OS_ALLOC_HUGE, 1},
+};
+
+/* Returns playouts per second, or a negative value on failure. */
+static double
+run(const char *name, const struct config *config, int inflight,
+    size_t size, double seconds, uint64_t seed)
+{
+    void *buf = os_alloc(size, config->flags);
+    if (!buf)
+        return -1;
+    if (config->numa && !os_numa(buf, size, -1)) {
+        os_free(buf, size);
+        return -1;
+    }
+    yavalath_ai_init_zeroed(buf, size, 0, 0, seed);
+    yavalath_ai_set_inflight(buf, inflight);
+
+    uint64_t start = os_uepoch();
+    uint64_t stop = start + seconds * 1e6;
+    uint64_t playouts = 0;
+    uint64_t now;
+    enum yavalath_result r;
+    do {
+        r = yavalath_ai_playout(buf, 4096);
+        if (r == YAVALATH_SUCCESS)
+            playouts += 4096;
+        now = os_uepoch();
+    } while (r == YAVALATH_SUCCESS && now < stop);
+
+    printf("%-18s %12.0f %10.2f%%%s\n", name,
+           playouts / ((now - start) / 1e6),
+           100.0 * yavalath_ai_get_nodes_used(buf) /
+           yavalath_ai_get_nodes_total(buf),
+           r == YAVALATH_BAILOUT_MEMORY ? " (out of memory)" : "");
+    os_free(buf, size);
+    return playouts / ((now - start) / 1e6);
+}
+
+static void
+print_usage(void)
+{
+    printf("yavalath-bench [options]\n");
+    printf("  -m<MB>        AI buffer size in megabytes (%d)\n", BUFFER_MB);
+    printf("  -t<seconds>   Duration of each run (%0.1f)\n", SECONDS);
+    printf("  -s<seed>      Search seed (%d)\n", SEED);
+    printf("  -k<max>       Also compare 1 to max playouts in flight\n");
+    printf("  -h            Print this help text\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t size = (size_t)BUFFER_MB << 20;
+    double seconds = SECONDS;
+    uint64_t seed = SEED;
+    int max_inflight = 0;
+
+    for (int i = 1; i < argc; i++) {
+        char *p = argv[i] + 1;
+        if (argv[i][0] != '-')
+            goto fail;
+        if (*p != 'h' && !p[1])
+            goto missing;
+        switch (*p) {
+            case 'm':
+                size = strtoull(p + 1, 0, 10) << 20;
+                break;
+            case 't':
+                seconds = strtod(p + 1, 0);
+                break;
+            case 's':
+                seed = strtoull(p + 1, 0, 10);
+                break;
+            case 'k':
+                max_inflight = strtol(p + 1, 0, 10);
+                if (max_inflight < 1 || max_inflight > YAVALATH_INFLIGHT_MAX)
+                    goto fail;
+                break;
+            case 'h':
+                print_usage();
+                exit(0);
+            default:
+                goto fail;
+        }
+        continue;
+  missing:
+        fprintf(stderr, "yavalath-bench: missing argument, %s\n", argv[i]);
+        exit(-1);
+  fail:
+        fprintf(stderr, "yavalath-bench: bad argument, %s\n", argv[i]);
+        exit(-1);
+    }
+
+    printf("%-18s %12s %11s\n", "allocation", "playouts/s", "memory");
+    for (size_t i = 0; i < sizeof(configs) / sizeof(*configs); i++)
+        if (run(configs[i].name, configs + i, 1, size, seconds, seed) < 0)
+            printf("%-18s %12s\n", configs[i].name, "unavailable");
+
+    if (max_inflight) {
+        printf("\n%-18s %12s %11s\n", "in flight", "playouts/s", "memory");
+        for (int k = 1; k <= max_inflight; k++) {
+            char name[16];
+            sprintf(name, "%d", k);
+            if (run(name, configs, k, size, seconds, seed) < 0)
+                printf("%-18s %12s\n", name, "unavailable");
+        }
+    }
+    return 0;
+}
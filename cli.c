@@ -1,33 +1,18 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include "yavalath.h"
+#include "os.h"
+#include "weights.h"
 
 #define TIMEOUT_MSEC (15 * 1000UL)
 #define MAX_PLAYOUTS UINT32_C(25000000)
 #define MEMORY_USAGE 0.8f
 
 #ifdef __unix__
-#include <unistd.h>
-#include <sys/time.h>
-
-static uint64_t
-os_uepoch(void)
-{
-    struct timeval tv;
-    gettimeofday(&tv, 0);
-    return UINT64_C(1000000) * tv.tv_sec + tv.tv_usec;
-}
-
-static size_t
-os_physical_memory(void)
-{
-    size_t pages = sysconf(_SC_PHYS_PAGES);
-    size_t page_size = sysconf(_SC_PAGE_SIZE);
-    return pages * page_size;
-}
-
 static void
 os_color(int color)
 {
@@ -52,27 +37,6 @@ os_finish(void)
 #elif _WIN32
 #include <windows.h>
 
-static uint64_t
-os_uepoch(void)
-{
-    FILETIME ft;
-    GetSystemTimeAsFileTime(&ft);
-    uint64_t tt = ft.dwHighDateTime;
-    tt <<= 32;
-    tt |= ft.dwLowDateTime;
-    tt /=10;
-    tt -= UINT64_C(11644473600000000);
-    return tt;
-}
-
-static size_t
-os_physical_memory(void)
-{
-    MEMORYSTATUSEX status = {.dwLength = sizeof(status)};
-    GlobalMemoryStatusEx(&status);
-    return status.ullTotalPhys;
-}
-
 static void
 os_color(int color)
 {
@@ -103,14 +67,17 @@ os_finish(void)
 }
 #endif
 
+#define RADIUS YAVALATH_RADIUS
+
 static void
-display(uint64_t w, uint64_t b, uint64_t highlight, int color)
+display(yavalath_bitboard w, yavalath_bitboard b,
+        yavalath_bitboard highlight, int color)
 {
-    for (int q = -4; q <= 4; q++) {
-        printf("%c ", 'a' + q + 4);
-        for (int s = 0; s < q + 4; s++)
+    for (int q = -RADIUS; q <= RADIUS; q++) {
+        printf("%c ", 'a' + q + RADIUS);
+        for (int s = 0; s < q + RADIUS; s++)
             putchar(' ');
-        for (int r = -4; r <= 4; r++) {
+        for (int r = -RADIUS; r <= RADIUS; r++) {
             int bit = yavalath_hex_to_bit(q, r);
             if (bit == -1)
                 fputs("  ", stdout);
@@ -133,46 +100,728 @@ display(uint64_t w, uint64_t b, uint64_t highlight, int color)
     }
 }
 
+/* Parse a hexadecimal bitboard, with or without a 0x prefix. */
+static int
+parse_bitboard(const char *s, yavalath_bitboard *out)
+{
+    yavalath_bitboard x = 0;
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+        s += 2;
+    if (!*s)
+        return 0;
+    for (; *s; s++) {
+        int d;
+        if (*s >= '0' && *s <= '9')
+            d = *s - '0';
+        else if (*s >= 'a' && *s <= 'f')
+            d = *s - 'a' + 10;
+        else if (*s >= 'A' && *s <= 'F')
+            d = *s - 'A' + 10;
+        else
+            return 0;
+        if (x >> (sizeof(x) * 8 - 4))
+            return 0; // too many digits
+        x = x << 4 | d;
+    }
+    *out = x;
+    return 1;
+}
+
+/* True if two bitboards form a legal arrangement of stones. */
+static int
+valid_position(yavalath_bitboard a, yavalath_bitboard b)
+{
+    return !(a & b) && !((a | b) >> YAVALATH_CELLS);
+}
+
+/* Write a bitboard as 0x-prefixed, zero-padded hexadecimal. */
+static void
+format_bitboard(char *s, yavalath_bitboard x)
+{
+#if YAVALATH_CELLS > 64
+    sprintf(s, "0x%016" PRIx64 "%016" PRIx64,
+            (uint64_t)(x >> 64), (uint64_t)x);
+#else
+    sprintf(s, "0x%016" PRIx64, x);
+#endif
+}
+
+/* Playouts between progress callbacks, a few milliseconds of search. */
+#define PROGRESS_INTERVAL 1024
+
+/* Default depth of an engine "dump". */
+#define DUMP_DEPTH 6
+
+/* Shared analysis cache defaults: its size when created, playouts
+ * seeded into each new node, and playouts a node needs to be shared.
+ */
+#define CACHE_MB      64
+#define CACHE_PRIOR   32
+#define CACHE_PUBLISH 256
+
+/* Leaf evaluator, applied after every AI initialization. */
+static struct {
+    int enabled;
+    float mix;
+    float weights[YAVALATH_EVAL_WEIGHTS];
+} evaluator = {0, -1.0f, {0}};
+
+/* Shared analysis cache, or NULL. */
+static struct {
+    void *p;
+    size_t size;
+} cache;
+
+/* Playouts interleaved in flight per search. */
+static int inflight = 1;
+
+static void
+ai_setup(void *buf)
+{
+    if (evaluator.enabled)
+        yavalath_ai_set_evaluator(buf, evaluator.weights, evaluator.mix);
+    if (cache.p)
+        yavalath_ai_set_cache(buf, cache.p, cache.size, CACHE_PRIOR);
+    yavalath_ai_set_inflight(buf, inflight);
+}
+
+/* Share what a finished search learned with other processes. */
+static void
+ai_publish(void *buf)
+{
+    if (cache.p)
+        yavalath_ai_publish(buf, CACHE_PUBLISH);
+}
+
 struct playout_limits {
     uint64_t msecs;
     uint32_t playouts;
+    uint64_t clock;             // msecs left on the game clock, 0 for none
+    uint64_t increment;         // msecs added to the clock after each move
+};
+
+#define NUMA_DEFAULT -2
+#define NUMA_INTERLEAVE -1
+
+struct alloc_options {
+    int flags;                  // os_alloc() flags
+    int numa;                   // node, or one of the NUMA_* values
+};
+
+/* Allocate an AI buffer, shrinking the request until it succeeds. */
+static void *
+alloc_buffer(size_t *size, struct alloc_options *options)
+{
+    void *buf;
+    do {
+        *size *= 0.95;
+        buf = os_alloc(*size, options->flags);
+    } while (!buf && *size > 1024 * 1024);
+    if (buf && options->numa != NUMA_DEFAULT)
+        if (!os_numa(buf, *size, options->numa))
+            fprintf(stderr, "yavalath-cli: NUMA placement failed\n");
+    return buf;
+}
+
+/* An AI buffer that may grow and shrink with the size of the tree. */
+struct buffer {
+    void *p;
+    size_t size;
+    size_t min_size;            // never shrink below this
+    size_t max_size;            // never grow beyond this
+    int flags;                  // os_alloc() flags
+};
+
+/* Double the buffer after a memory bailout. Returns 0 at the limit. */
+static int
+buffer_grow(struct buffer *b)
+{
+    if (b->size >= b->max_size)
+        return 0;
+    size_t size = b->size * 2 < b->max_size ? b->size * 2 : b->max_size;
+    void *p = os_realloc(b->p, b->size, size, b->flags);
+    if (!p)
+        return 0;
+    b->p = p;  // may have moved even if the AI cannot use the space
+    b->size = size;
+    return yavalath_ai_resize(p, size) == YAVALATH_SUCCESS;
+}
+
+/* Halve the buffer while the tree uses only a small part of it. */
+static void
+buffer_trim(struct buffer *b)
+{
+    while (b->size / 2 >= b->min_size &&
+           yavalath_ai_get_nodes_used(b->p) <
+           yavalath_ai_get_nodes_total(b->p) / 8) {
+        size_t size = b->size / 2;
+        if (yavalath_ai_resize(b->p, size) != YAVALATH_SUCCESS)
+            break;
+        void *p = os_realloc(b->p, b->size, size, b->flags);
+        if (!p)
+            break; // keep the larger mapping, the AI just uses less
+        b->p = p;
+        b->size = size;
+    }
+}
+
+/* Search deadline and display state shared with progress callbacks. */
+struct search_clock {
+    uint64_t start;
+    uint64_t timeout;           // 0 for no time limit
+    uint64_t last;              // time of the last progress output
+    struct buffer *b;           // searched buffer when on a game clock
+    struct yavalath_timer timer;
 };
 
+/* Start timing a search. With a game clock the AI budgets its own
+ * time, and the timeout is only the hard limit shown while searching.
+ */
 static void
-playout_to_limit(void *buf, struct playout_limits *limits)
+search_clock_start(struct search_clock *c, struct playout_limits *limits,
+                   struct buffer *b)
+{
+    c->start = c->last = os_uepoch();
+    c->timeout = limits->msecs ? c->start + limits->msecs * 1000 : 0;
+    c->b = 0;
+    if (limits->clock) {
+        c->b = b;
+        yavalath_timer_start(&c->timer, b->p, limits->clock,
+                             limits->increment);
+        c->timeout = c->start + c->timer.limit * 1000;
+    }
+}
+
+static int
+search_clock_expired(struct search_clock *c, uint64_t now)
 {
-    uint64_t timeout = os_uepoch() + limits->msecs * 1000;
-    uint32_t playouts = 0;
-    uint32_t iterations = 64 * 1024;
+    /* Growing may move the buffer, so it is looked up every time. */
+    if (c->b)
+        return yavalath_timer_check(&c->timer, c->b->p,
+                                    (now - c->start) / 1000);
+    return c->timeout && now >= c->timeout;
+}
+
+static void
+print_progress(const struct yavalath_progress *p, struct search_clock *c,
+               uint64_t now)
+{
+    os_restart_line();
+    printf("%.2f%% memory usage, %" PRIu64 " playouts, %0.1fs %s",
+           100 * p->nodes_used / (double)p->nodes_total, p->total_playouts,
+           c->timeout ? (c->timeout - now) / 1e6 : (now - c->start) / 1e6,
+           c->timeout ? "remaining" : "spent");
+    fflush(stdout);
+}
+
+static int
+show_progress(const struct yavalath_progress *p, void *arg)
+{
+    struct search_clock *c = arg;
+    uint64_t now = os_uepoch();
+    if (now - c->last >= 250000) {
+        print_progress(p, c, now);
+        c->last = now;
+    }
+    return search_clock_expired(c, now);
+}
+
+/* Run a search to the given limits, growing the buffer as needed.
+ * Returns the final result of `yavalath_ai_search()`.
+ */
+static enum yavalath_result
+search_to_limit(struct buffer *b, struct playout_limits *limits,
+                yavalath_progress_fn callback, void *arg)
+{
+    uint64_t before = yavalath_ai_get_total_playouts(b->p);
     enum yavalath_result r;
     do {
-        if (playouts + iterations > limits->playouts)
-            iterations = limits->playouts - playouts;
-        uint64_t time_start = os_uepoch();
-        r = yavalath_ai_playout(buf, iterations);
-        uint64_t time_end = os_uepoch();
-        uint64_t run_time = time_end - time_start;
-        if (r == YAVALATH_SUCCESS)
-            playouts += iterations;
-        if (run_time > 300000)
-            iterations *= 0.85f;
-        else if (run_time < 250000)
-            iterations *= 1.18f;
-        os_restart_line();
-        uint32_t nodes_used = yavalath_ai_get_nodes_used(buf);
-        uint32_t nodes_total = yavalath_ai_get_nodes_total(buf);
-        printf("%.2f%% memory usage, %" PRIu32 " playouts, %0.1fs %s",
-               100 * nodes_used / (double)nodes_total,
-               yavalath_ai_get_total_playouts(buf),
-               (timeout / 1e6 - time_end / 1e6) * (limits->msecs ? 1 : -1),
-               limits->msecs ? "remaining" : "spent");
-        fflush(stdout);
-    } while (r == YAVALATH_SUCCESS &&
-             (!limits->msecs || (os_uepoch() < timeout)) &&
-             playouts < limits->playouts);
+        uint64_t done = yavalath_ai_get_total_playouts(b->p) - before;
+        r = yavalath_ai_search(b->p, limits->playouts - done,
+                               PROGRESS_INTERVAL, callback, arg, 0);
+    } while (r == YAVALATH_BAILOUT_MEMORY && buffer_grow(b));
+    ai_publish(b->p);
+    return r;
+}
+
+static void
+playout_to_limit(struct buffer *b, struct playout_limits *limits)
+{
+    struct search_clock c;
+    search_clock_start(&c, limits, b);
+    search_to_limit(b, limits, show_progress, &c);
+    struct yavalath_progress p = {
+        .total_playouts = yavalath_ai_get_total_playouts(b->p),
+        .nodes_used = yavalath_ai_get_nodes_used(b->p),
+        .nodes_total = yavalath_ai_get_nodes_total(b->p),
+    };
+    uint64_t now = os_uepoch();
+    print_progress(&p, &c, c.timeout && now > c.timeout ? c.timeout : now);
     puts(" ... done\n");
 }
 
+/* Engine protocol mode */
+
+struct engine {
+    struct buffer *b;
+    uint64_t seed;
+    yavalath_bitboard start[2]; // initial stones, side to move first
+    int moves[YAVALATH_CELLS];
+    int nmoves;
+    int over;                   // game already decided
+    char queue[16][256];        // lines that arrived during a search
+    int queue_head;
+    int queue_len;
+    int quit;                   // quit or end of input seen during a search
+};
+
+static void
+engine_reset(struct engine *e, const yavalath_bitboard start[2])
+{
+    e->start[0] = start[0];
+    e->start[1] = start[1];
+    e->nmoves = 0;
+    e->over = 0;
+    yavalath_ai_init(e->b->p, e->b->size, start[0], start[1], e->seed++);
+    ai_setup(e->b->p);
+}
+
+static void
+engine_position(struct engine *e, char *args)
+{
+    yavalath_bitboard start[2] = {0, 0};
+    int moves[YAVALATH_CELLS];
+    int nmoves = 0;
+    char *tok = strtok(args, " \t\r\n");
+    if (tok && strcmp(tok, "startpos")) {
+        char *hex1 = strtok(0, " \t\r\n");
+        if (!hex1) {
+            puts("info error missing position");
+            return;
+        }
+        if (!parse_bitboard(tok, start) || !parse_bitboard(hex1, start + 1)) {
+            puts("info error invalid position");
+            return;
+        }
+    }
+    yavalath_bitboard board[2] = {start[0], start[1]};
+    if (!valid_position(board[0], board[1])) {
+        puts("info error invalid position");
+        return;
+    }
+    tok = strtok(0, " \t\r\n");
+    if (tok && !strcmp(tok, "moves")) {
+        while ((tok = strtok(0, " \t\r\n"))) {
+            int bit = yavalath_notation_to_bit(tok);
+            if (bit == -1 || (((board[0] | board[1]) >> bit) & 1)) {
+                printf("info error invalid move %s\n", tok);
+                return;
+            }
+            board[nmoves % 2] |= YAVALATH_BIT(bit);
+            moves[nmoves++] = bit;
+        }
+    }
+
+    /* Keep the existing tree when the game has only moved forward. */
+    int reuse = start[0] == e->start[0] && start[1] == e->start[1] &&
+                nmoves >= e->nmoves;
+    for (int i = 0; reuse && i < e->nmoves; i++)
+        reuse = moves[i] == e->moves[i];
+    if (!reuse)
+        engine_reset(e, start);
+
+    board[0] = start[0];
+    board[1] = start[1];
+    for (int i = 0; i < nmoves; i++) {
+        int turn = i % 2;
+        board[turn] |= YAVALATH_BIT(moves[i]);
+        if (i < e->nmoves)
+            continue;
+        yavalath_ai_advance(e->b->p, moves[i]);
+        e->moves[e->nmoves++] = moves[i];
+        if (yavalath_check(board[turn], board[!turn], moves[i], 0))
+            e->over = 1;
+    }
+    yavalath_ai_compact(e->b->p);
+    buffer_trim(e->b);
+}
+
+static void
+engine_info(struct engine *e, uint64_t playouts, uint64_t usecs)
+{
+    char move[YAVALATH_NOTATION_MAX] = "--";
+    double score = 0;
+    if (yavalath_ai_get_total_playouts(e->b->p)) {
+        int bit = yavalath_ai_best_move(e->b->p);
+        score = yavalath_ai_get_move_score(e->b->p, bit);
+        yavalath_bit_to_notation(move, bit);
+    }
+    printf("info move %s score %.4f playouts %" PRIu64 " nps %.0f "
+           "memory %.2f pv",
+           move, score, yavalath_ai_get_total_playouts(e->b->p),
+           usecs ? playouts / (usecs / 1e6) : 0.0,
+           100 * yavalath_ai_get_nodes_used(e->b->p) /
+           (double)yavalath_ai_get_nodes_total(e->b->p));
+    int pv[YAVALATH_CELLS];
+    int npv = yavalath_ai_get_pv(e->b->p, pv, YAVALATH_CELLS);
+    for (int i = 0; i < npv; i++) {
+        yavalath_bit_to_notation(move, pv[i]);
+        printf(" %s", move);
+    }
+    putchar('\n');
+}
+
+static int
+write_file(const void *data, size_t len, void *arg)
+{
+    return fwrite(data, len, 1, arg) != 1;
+}
+
+/* Write the search tree to a file: dump <path> [depth] [playouts] */
+static void
+engine_dump(struct engine *e, char *args)
+{
+    char *path = strtok(args, " \t\r\n");
+    char *depth = strtok(0, " \t\r\n");
+    char *min = depth ? strtok(0, " \t\r\n") : 0;
+    if (!path) {
+        puts("info error missing path");
+        return;
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        printf("info error cannot open %s\n", path);
+        return;
+    }
+    enum yavalath_result r =
+        yavalath_ai_dump(e->b->p, depth ? atoi(depth) : DUMP_DEPTH,
+                         min ? strtoull(min, 0, 10) : 1, write_file, f);
+    if (fclose(f) || r != YAVALATH_SUCCESS)
+        printf("info error writing %s\n", path);
+    else
+        printf("info dump %s\n", path);
+}
+
+/* State of a search in progress, for engine_poll(). */
+struct engine_search {
+    struct engine *e;
+    struct search_clock clock;
+    uint64_t base;              // root playouts when the search began
+    int ponder;
+    int infinite;               // no limit, only "stop" ends it
+};
+
+/* Progress callback: read input, report once a second, and decide
+ * whether to stop. Only "stop" ends a go, and any command ends a
+ * ponder. Other commands are queued for later, or dropped with an
+ * error when the queue is full. Input is always read so that "stop"
+ * is never missed. Once "quit" or end of input arrives there is
+ * nobody left to send "stop", so an infinite search ends too.
+ */
+static int
+engine_poll(const struct yavalath_progress *p, void *arg)
+{
+    struct engine_search *s = arg;
+    struct engine *e = s->e;
+    while (!e->quit && os_input_ready()) {
+        char line[sizeof(e->queue[0])];
+        if (!fgets(line, sizeof(line), stdin)) {
+            e->quit = 1;
+            break;
+        }
+        if (!strncmp(line, "isready", 7)) {
+            puts("readyok");
+            fflush(stdout);
+            continue;
+        }
+        if (!strncmp(line, "dump", 4) && strchr(" \t\r\n", line[4])) {
+            engine_dump(e, line + 4);
+            fflush(stdout);
+            continue;
+        }
+        if (!strncmp(line, "stop", 4))
+            return 1;
+        if (!strncmp(line, "quit", 4)) {
+            e->quit = 1;
+        } else if (e->queue_len == 16) {
+            line[strcspn(line, "\r\n")] = 0;
+            printf("info error queue full, dropped %s\n", line);
+            fflush(stdout);
+            continue;
+        } else {
+            strcpy(e->queue[(e->queue_head + e->queue_len) % 16], line);
+            e->queue_len++;
+        }
+        if (s->ponder)
+            return 1;
+    }
+    if (e->quit && s->infinite)
+        return 1;
+    uint64_t now = os_uepoch();
+    if (now - s->clock.last >= 1000000) {
+        engine_info(e, p->total_playouts - s->base, now - s->clock.start);
+        fflush(stdout);
+        s->clock.last = now;
+    }
+    return search_clock_expired(&s->clock, now);
+}
+
+/* Search until a limit is reached or "stop" arrives. */
+static void
+engine_search(struct engine *e, struct playout_limits *limits, int ponder)
+{
+    struct engine_search s = {
+        .e = e,
+        .base = yavalath_ai_get_total_playouts(e->b->p),
+        .ponder = ponder,
+        .infinite = !limits->msecs && !limits->clock &&
+                    limits->playouts == UINT32_MAX,
+    };
+    search_clock_start(&s.clock, limits, e->b);
+    if (!e->over)
+        search_to_limit(e->b, limits, engine_poll, &s);
+    engine_info(e, yavalath_ai_get_total_playouts(e->b->p) - s.base,
+                os_uepoch() - s.clock.start);
+    if (!ponder) {
+        char move[YAVALATH_NOTATION_MAX] = "--";
+        if (!e->over && yavalath_ai_get_total_playouts(e->b->p))
+            yavalath_bit_to_notation(move, yavalath_ai_best_move(e->b->p));
+        printf("bestmove %s\n", move);
+    }
+    fflush(stdout);
+}
+
+static void
+engine(struct buffer *b, uint64_t seed, struct playout_limits *limits)
+{
+    static const yavalath_bitboard empty[2] = {0, 0};
+    struct engine e = {.b = b, .seed = seed};
+    engine_reset(&e, empty);
+    setvbuf(stdin, 0, _IONBF, 0);
+    for (;;) {
+        char line[256];
+        if (e.queue_len) {
+            strcpy(line, e.queue[e.queue_head]);
+            e.queue_head = (e.queue_head + 1) % 16;
+            e.queue_len--;
+        } else if (e.quit || !fgets(line, sizeof(line), stdin)) {
+            break;
+        }
+        char *args = line + strcspn(line, " \t\r\n");
+        if (*args)
+            *args++ = 0;
+        if (!strcmp(line, "quit")) {
+            break;
+        } else if (!strcmp(line, "isready")) {
+            puts("readyok");
+        } else if (!strcmp(line, "newgame")) {
+            engine_reset(&e, empty);
+        } else if (!strcmp(line, "position")) {
+            engine_position(&e, args);
+        } else if (!strcmp(line, "dump")) {
+            engine_dump(&e, args);
+        } else if (!strcmp(line, "go") || !strcmp(line, "ponder")) {
+            struct playout_limits go = *limits;
+            go.clock = go.increment = 0;  // the controller keeps the clock
+            if (!strcmp(line, "ponder"))
+                go = (struct playout_limits){.playouts = UINT32_MAX};
+            char *tok = strtok(args, " \t\r\n");
+            for (; tok; tok = strtok(0, " \t\r\n")) {
+                if (!strcmp(tok, "infinite")) {
+                    go = (struct playout_limits){.playouts = UINT32_MAX};
+                } else if (!strcmp(tok, "time")) {
+                    if ((tok = strtok(0, " \t\r\n")))
+                        go.msecs = strtoull(tok, 0, 10);
+                } else if (!strcmp(tok, "playouts")) {
+                    if ((tok = strtok(0, " \t\r\n")))
+                        go.playouts = strtoul(tok, 0, 10);
+                } else if (!strcmp(tok, "clock")) {
+                    if ((tok = strtok(0, " \t\r\n")))
+                        go.clock = strtoull(tok, 0, 10);
+                } else if (!strcmp(tok, "inc")) {
+                    if ((tok = strtok(0, " \t\r\n")))
+                        go.increment = strtoull(tok, 0, 10);
+                }
+            }
+            engine_search(&e, &go, line[0] == 'p');
+        } else if (!strcmp(line, "stop") || !line[0]) {
+            // nothing to stop
+        } else {
+            printf("info error unknown command %s\n", line);
+        }
+        fflush(stdout);
+    }
+}
+
+/* Batch analysis mode */
+
+struct analysis {
+    FILE *in;
+    size_t size;                // buffer size per worker
+    struct alloc_options alloc;
+    uint64_t seed;
+    struct playout_limits limits;
+    unsigned long lineno;
+    pthread_mutex_t lock;
+};
+
+static int
+check_deadline(const struct yavalath_progress *p, void *arg)
+{
+    (void)p;
+    uint64_t *timeout = arg;
+    return *timeout && os_uepoch() >= *timeout;
+}
+
+/* Run playouts quietly until a limit is reached. */
+static void
+playout_quiet(void *buf, struct playout_limits *limits)
+{
+    uint64_t timeout = limits->msecs ? os_uepoch() + limits->msecs * 1000 : 0;
+    yavalath_ai_search(buf, limits->playouts, PROGRESS_INTERVAL,
+                       check_deadline, &timeout, 0);
+    ai_publish(buf);
+}
+
+/**
+ * Parse a position as either two 0x-prefixed hex bitboards (side to
+ * move first) or a list of moves from the empty board. Returns 0 for
+ * invalid input, 1 for a playable position, and 2 if the game is
+ * already over.
+ */
+static int
+parse_position(char *line, yavalath_bitboard out[2])
+{
+    yavalath_bitboard board[2] = {0, 0};
+    int turn = 0;
+    char *save;
+    char *tok = strtok_r(line, " \t\r\n,", &save);
+    if (tok && !strncmp(tok, "0x", 2)) {
+        char *hex1 = strtok_r(0, " \t\r\n,", &save);
+        if (!hex1)
+            return 0;
+        if (!parse_bitboard(tok, out) || !parse_bitboard(hex1, out + 1))
+            return 0;
+        if (!valid_position(out[0], out[1]))
+            return 0;
+        return 1;
+    }
+    int over = 0;
+    for (; tok; tok = strtok_r(0, " \t\r\n,", &save)) {
+        int bit = yavalath_notation_to_bit(tok);
+        if (over || bit == -1 || (((board[0] | board[1]) >> bit) & 1))
+            return 0;
+        board[turn] |= YAVALATH_BIT(bit);
+        over = yavalath_check(board[turn], board[!turn], bit, 0) != 0;
+        turn = !turn;
+    }
+    out[0] = board[turn];
+    out[1] = board[!turn];
+    return over ? 2 : 1;
+}
+
+static void *
+analyze_worker(void *arg)
+{
+    struct analysis *a = arg;
+    size_t size = a->size;
+    void *buf = alloc_buffer(&size, &a->alloc);
+    if (!buf) {
+        fprintf(stderr, "yavalath-cli: out of memory\n");
+        exit(-1);
+    }
+    for (;;) {
+        char line[1024];
+        pthread_mutex_lock(&a->lock);
+        int eof = !fgets(line, sizeof(line), a->in);
+        unsigned long lineno = ++a->lineno;
+        uint64_t seed = a->seed++;
+        pthread_mutex_unlock(&a->lock);
+        if (eof)
+            break;
+        line[strcspn(line, "\r\n")] = 0;
+        if (!line[strspn(line, " \t")] || line[0] == '#')
+            continue;
+
+        char out[4096];
+        int len = sprintf(out, "{\"line\":%lu", lineno);
+        yavalath_bitboard board[2];
+        char copy[sizeof(line)];
+        strcpy(copy, line);
+        switch (parse_position(copy, board)) {
+            case 0:
+                len += sprintf(out + len, ",\"error\":\"invalid position\"");
+                break;
+            case 2:
+                len += sprintf(out + len, ",\"error\":\"game over\"");
+                break;
+            case 1: {
+                uint64_t start = os_uepoch();
+                yavalath_ai_init(buf, size, board[0], board[1], seed);
+                ai_setup(buf);
+                playout_quiet(buf, &a->limits);
+                char move[YAVALATH_NOTATION_MAX];
+                int best = yavalath_ai_best_move(buf);
+                yavalath_bit_to_notation(move, best);
+                char hex[2][35];
+                format_bitboard(hex[0], board[0]);
+                format_bitboard(hex[1], board[1]);
+                len += sprintf(out + len,
+                               ",\"position\":[\"%s\",\"%s\"]"
+                               ",\"playouts\":%" PRIu64
+                               ",\"usecs\":%" PRIu64
+                               ",\"best\":\"%s\",\"scores\":{",
+                               hex[0], hex[1],
+                               yavalath_ai_get_total_playouts(buf),
+                               os_uepoch() - start, move);
+                /* Pruned and unvisited moves have no score to report. */
+                const char *sep = "";
+                for (int i = 0; i < YAVALATH_CELLS; i++) {
+                    if (yavalath_ai_get_move_playouts(buf, i)) {
+                        yavalath_bit_to_notation(move, i);
+                        len += sprintf(out + len, "%s\"%s\":%.5f", sep, move,
+                                       yavalath_ai_get_move_score(buf, i));
+                        sep = ",";
+                    }
+                }
+                len += sprintf(out + len, "}");
+            } break;
+        }
+        pthread_mutex_lock(&a->lock);
+        printf("%s}\n", out);
+        fflush(stdout);
+        pthread_mutex_unlock(&a->lock);
+    }
+    os_free(buf, size);
+    return NULL;
+}
+
+static void
+analyze(const char *path, int nthreads, size_t size, uint64_t seed,
+        struct playout_limits *limits, struct alloc_options *alloc)
+{
+    struct analysis a = {
+        .in = strcmp(path, "-") ? fopen(path, "r") : stdin,
+        .size = size / nthreads,
+        .alloc = *alloc,
+        .seed = seed,
+        .limits = *limits,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+    };
+    if (!a.in) {
+        fprintf(stderr, "yavalath-cli: could not open %s\n", path);
+        exit(-1);
+    }
+    pthread_t *threads = malloc(sizeof(*threads) * nthreads);
+    for (int i = 0; i < nthreads; i++)
+        pthread_create(threads + i, NULL, analyze_worker, &a);
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+    if (a.in != stdin)
+        fclose(a.in);
+}
+
 static void
 print_usage(void)
 {
@@ -183,10 +832,30 @@ print_usage(void)
            "(c)\n");
     printf("  -t<seconds>   Set AI timeout in fractional seconds, "
            "(%0.1f)\n", TIMEOUT_MSEC / 1e3);
+    printf("  -T<s>[+<s>]   Play on a game clock of this many seconds per "
+           "AI,\n");
+    printf("                plus an increment per move, instead of -t\n");
     printf("  -p<playouts>  Set maximum number of playouts for AI, "
            "(%" PRIu32 ")\n", MAX_PLAYOUTS);
     printf("  -m<0.0-1.0>   Fraction of physical memory to use for AI "
            "(%0.1f)\n", MEMORY_USAGE);
+    printf("  -g<MB>        Start the AI buffer small and grow it "
+           "as needed\n");
+    printf("  -H            Back the AI buffer with huge pages\n");
+    printf("  -N<node|i>    Bind AI memory to a NUMA node, or interleave\n");
+    printf("  -k<1-%d>      Playouts in flight at once, to overlap memory "
+           "stalls (1)\n", YAVALATH_INFLIGHT_MAX);
+    printf("  -e            Engine protocol mode on standard input\n");
+    printf("  -a<file>      Analyze positions from a file (- for stdin) "
+           "as JSONL\n");
+    printf("  -j<threads>   Number of analysis worker threads (ncpu)\n");
+    printf("  -w<file>      Evaluate leaves with weights from yavalath-train\n");
+    printf("  -x<0.0-1.0>   Evaluator share of each leaf value with -w "
+           "(1.0)\n");
+    printf("  -c</name>     Share analysis with other processes through "
+           "this\n");
+    printf("                shared memory cache, creating it if needed\n");
+    printf("  -C<MB>        Size of a newly created cache (%d)\n", CACHE_MB);
     printf("  -h            Print this help text\n\n");
 
     printf("For example, to see AI vs. AI with 1 minute turns:\n");
@@ -197,9 +866,16 @@ int
 main(int argc, char **argv)
 {
     uint64_t seed = os_uepoch();
-    uint64_t board[2] = {0, 0};
+    yavalath_bitboard board[2] = {0, 0};
     unsigned turn = 0;
     float memory_usage = MEMORY_USAGE;
+    int engine_mode = 0;
+    const char *analyze_path = NULL;
+    int nthreads = os_cpu_count();
+    struct alloc_options alloc = {0, NUMA_DEFAULT};
+    size_t initial_mb = 0;
+    const char *cache_name = NULL;
+    size_t cache_mb = CACHE_MB;
     enum player_type {
         PLAYER_HUMAN,
         PLAYER_AI
@@ -236,6 +912,16 @@ main(int argc, char **argv)
                         goto missing;
                     limits.msecs = strtod(p + 1, 0) * 1000;
                     break;
+                case 'T': {
+                    if (!p[1])
+                        goto missing;
+                    char *end;
+                    limits.clock = strtod(p + 1, &end) * 1000;
+                    if (*end == '+')
+                        limits.increment = strtod(end + 1, &end) * 1000;
+                    if (*end || !limits.clock)
+                        goto fail;
+                } break;
                 case 'p':
                     if (!p[1])
                         goto missing;
@@ -248,6 +934,74 @@ main(int argc, char **argv)
                         goto missing;
                     memory_usage = strtof(p + 1, 0);
                     break;
+                case 'k':
+                    if (!p[1])
+                        goto missing;
+                    inflight = strtol(p + 1, 0, 10);
+                    if (inflight < 1 || inflight > YAVALATH_INFLIGHT_MAX)
+                        goto fail;
+                    break;
+                case 'e':
+                    engine_mode = 1;
+                    break;
+                case 'a':
+                    if (!p[1])
+                        goto missing;
+                    analyze_path = p + 1;
+                    break;
+                case 'g':
+                    if (!p[1])
+                        goto missing;
+                    initial_mb = strtoull(p + 1, 0, 10);
+                    break;
+                case 'H':
+                    alloc.flags |= OS_ALLOC_HUGE;
+                    break;
+                case 'N':
+                    if (!p[1])
+                        goto missing;
+                    if (p[1] == 'i')
+                        alloc.numa = NUMA_INTERLEAVE;
+                    else
+                        alloc.numa = strtol(p + 1, 0, 10);
+                    break;
+                case 'j':
+                    if (!p[1])
+                        goto missing;
+                    nthreads = strtol(p + 1, 0, 10);
+                    if (nthreads < 1)
+                        nthreads = 1;
+                    break;
+                case 'w':
+                    if (!p[1])
+                        goto missing;
+                    if (!weights_load(p + 1, evaluator.weights,
+                                      YAVALATH_EVAL_WEIGHTS)) {
+                        fprintf(stderr, "yavalath-cli: cannot read weights, "
+                                "%s\n", p + 1);
+                        exit(-1);
+                    }
+                    evaluator.enabled = 1;
+                    break;
+                case 'x':
+                    if (!p[1])
+                        goto missing;
+                    evaluator.mix = strtof(p + 1, 0);
+                    if (!(evaluator.mix >= 0 && evaluator.mix <= 1))
+                        goto fail;
+                    break;
+                case 'c':
+                    if (!p[1])
+                        goto missing;
+                    cache_name = p + 1;
+                    break;
+                case 'C':
+                    if (!p[1])
+                        goto missing;
+                    cache_mb = strtoull(p + 1, 0, 10);
+                    if (!cache_mb)
+                        goto fail;
+                    break;
                 case 'h':
                     print_usage();
                     exit(0);
@@ -264,23 +1018,64 @@ main(int argc, char **argv)
         exit(-1);
     }
 
+    if (evaluator.mix < 0)
+        evaluator.mix = 1.0f;
+    else if (!evaluator.enabled)
+        fprintf(stderr, "yavalath-cli: -x has no effect without -w\n");
+
+    if (cache_name) {
+        cache.size = cache_mb << 20;
+        cache.p = os_shm_open(cache_name, &cache.size);
+        if (!cache.p) {
+            fprintf(stderr, "yavalath-cli: cannot open cache, %s\n",
+                    cache_name);
+            exit(-1);
+        }
+        if (yavalath_cache_init(cache.p, cache.size) != YAVALATH_SUCCESS) {
+            fprintf(stderr, "yavalath-cli: incompatible cache, %s\n",
+                    cache_name);
+            exit(-1);
+        }
+    }
+
     size_t physical_memory = os_physical_memory();
     size_t size = physical_memory * memory_usage;
-    void *buf = NULL;
-    if (player_type[0] == PLAYER_AI || player_type[1] == PLAYER_AI) {
-        do {
-            size *= 0.95;
-            buf = malloc(size);
-        } while (!buf);
-        yavalath_ai_init(buf, size, 0, 0, seed);
+    struct buffer buf = {0};
+    if (analyze_path) {
+        analyze(analyze_path, nthreads, size, seed, &limits, &alloc);
+        return 0;
+    }
+    if (engine_mode ||
+        player_type[0] == PLAYER_AI || player_type[1] == PLAYER_AI) {
+        buf.size = initial_mb && initial_mb << 20 < size ?
+                   initial_mb << 20 : size;
+        buf.p = alloc_buffer(&buf.size, &alloc);
+        if (!buf.p) {
+            fprintf(stderr, "yavalath-cli: out of memory\n");
+            exit(-1);
+        }
+        buf.min_size = buf.size;
+        buf.max_size = initial_mb ? size : buf.size;
+        buf.flags = alloc.flags;
+        if (engine_mode) {
+            engine(&buf, seed, &limits);
+            os_free(buf.p, buf.size);
+            return 0;
+        }
+        yavalath_ai_init_zeroed(buf.p, buf.size, 0, 0, seed);
+        ai_setup(buf.p);
         printf("%zu MB physical memory found, "
-               "AI will use %zu MB (%" PRIu32 " nodes)\n",
+               "AI will use %zu MB (%" PRIu64 " nodes)",
                physical_memory / 1024 / 1024,
-               size / 1024 / 1024,
-               yavalath_ai_get_nodes_total(buf));
+               buf.size / 1024 / 1024,
+               yavalath_ai_get_nodes_total(buf.p));
+        if (buf.max_size > buf.size)
+            printf(", growing up to %zu MB", buf.max_size / 1024 / 1024);
+        putchar('\n');
     }
 
-    uint64_t last_play = 0;
+    uint64_t clock[2] = {limits.clock, limits.clock};
+    yavalath_bitboard last_play = 0;
     for (;;) {
         display(board[0], board[1], last_play, 3);
         fflush(stdout);
@@ -304,17 +1099,34 @@ main(int argc, char **argv)
                     }
                 }
                 break;
-            case PLAYER_AI:
+            case PLAYER_AI: {
                 putchar('\n');
-                playout_to_limit(buf, &limits);
-                bit = yavalath_ai_best_move(buf);
-                break;
+                struct playout_limits move_limits = limits;
+                if (limits.clock) {
+                    move_limits.msecs = 0;
+                    move_limits.clock = clock[turn] ? clock[turn] : 1;
+                }
+                uint64_t start = os_uepoch();
+                playout_to_limit(&buf, &move_limits);
+                bit = yavalath_ai_best_move(buf.p);
+                if (limits.clock) {
+                    uint64_t spent = (os_uepoch() - start) / 1000;
+                    clock[turn] = clock[turn] > spent ? clock[turn] - spent
+                                                      : 0;
+                    clock[turn] += limits.increment;
+                    printf("%.1fs left on %c's clock\n", clock[turn] / 1e3,
+                           "ox"[turn]);
+                }
+            } break;
+        }
+        last_play = YAVALATH_BIT(bit);
+        if (buf.p) {
+            yavalath_ai_advance(buf.p, bit);
+            yavalath_ai_compact(buf.p);
+            buffer_trim(&buf);
         }
-        last_play = UINT64_C(1) << bit;
-        if (buf)
-            yavalath_ai_advance(buf, bit);
-        board[turn] |= UINT64_C(1) << bit;
-        uint64_t where;
+        board[turn] |= YAVALATH_BIT(bit);
+        yavalath_bitboard where;
         enum yavalath_game_result result;
         result = yavalath_check(board[turn], board[!turn], bit, &where);
         switch (result) {
@@ -340,7 +1152,8 @@ main(int argc, char **argv)
     }
 
 done:
-    free(buf);
+    if (buf.p)
+        os_free(buf.p, buf.size);
     os_finish();
     return 0;
 }
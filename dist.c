@@ -0,0 +1,590 @@
+/**
+ * Yavalath distributed search
+ *
+ * Spreads the search of one game across worker processes, on this
+ * machine or others, using root parallelism: every worker searches the
+ * same position in its own AI buffer with its own seed and streams its
+ * root move statistics to a coordinator over TCP. The coordinator sums
+ * them and plays the move with the best combined mean.
+ *
+ * The coordinator waits for its workers to connect, then reads
+ * commands from standard input:
+ *   new                -> ok new
+ *   play <move>        -> ok play [win|loss|draw]
+ *   go [msecs]         -> info lines, then bestmove <move> <score> <n>
+ *   workers            -> workers <n>
+ *   quit
+ * Failures are reported as "error <reason>".
+ *
+ * Coordinator to worker:
+ *   new <seed>
+ *   play <bit>
+ *   go <msecs> <report interval msecs>
+ *   quit
+ * Worker to coordinator, during a go:
+ *   stats <total> <bit>:<playouts>:<reward sum> ...
+ *   done
+ * or at any time, after a move it cannot play:
+ *   error <reason>
+ * A worker that reports an error is out of step with the game and is
+ * dropped.
+ * Statistics are cumulative for the current root, so each report
+ * replaces the previous one and a late report only delays the
+ * coordinator's view.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "yavalath.h"
+#include "os.h"
+
+#define BUFFER_MB     1024
+#define TIMEOUT_MSEC  (5 * 1000UL)
+#define REPORT_MSEC   250
+#define GRACE_MSEC    (5 * 1000UL)  // extra wait for a slow worker
+#define SLICE         UINT32_C(1024)
+#define RETRIES       30            // seconds to wait for a coordinator
+#define LINE_MAX_LEN  16384
+
+struct peer {
+    int fd;
+    int done;
+    size_t len;
+    char buf[LINE_MAX_LEN];
+    uint64_t total;
+    uint64_t playouts[YAVALATH_CELLS];
+    double reward[YAVALATH_CELLS];
+};
+
+static struct peer *peers;
+static int npeers;
+
+/* Split "host:port" in place. The host may be empty. */
+static char *
+split_port(char *spec)
+{
+    char *colon = strrchr(spec, ':');
+    if (!colon)
+        return spec;
+    *colon = 0;
+    return colon + 1;
+}
+
+static int
+tcp_listen(char *spec)
+{
+    char *port = split_port(spec);
+    const char *host = port == spec || !*spec ? NULL : spec;
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+        .ai_flags = AI_PASSIVE,
+    };
+    struct addrinfo *res;
+    if (getaddrinfo(host, port, &hints, &res))
+        return -1;
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai && fd == -1; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd == -1)
+            continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) || listen(fd, 64)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static int
+tcp_connect(char *spec)
+{
+    char *port = split_port(spec);
+    if (port == spec)
+        return -1;
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+    };
+    for (int tries = 0; tries < RETRIES; tries++) {
+        struct addrinfo *res;
+        if (!getaddrinfo(spec, port, &hints, &res)) {
+            for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+                int fd = socket(ai->ai_family, ai->ai_socktype,
+                                ai->ai_protocol);
+                if (fd == -1)
+                    continue;
+                if (!connect(fd, ai->ai_addr, ai->ai_addrlen)) {
+                    freeaddrinfo(res);
+                    return fd;
+                }
+                close(fd);
+            }
+            freeaddrinfo(res);
+        }
+        sleep(1);
+    }
+    return -1;
+}
+
+/* Disable Nagle's algorithm so small reports go out immediately. */
+static void
+tcp_nodelay(int fd)
+{
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+/* Worker */
+
+static void
+worker_report(void *buf, FILE *out)
+{
+    fprintf(out, "stats %" PRIu64, yavalath_ai_get_total_playouts(buf));
+    for (int i = 0; i < YAVALATH_CELLS; i++) {
+        uint64_t n = yavalath_ai_get_move_playouts(buf, i);
+        if (n)
+            fprintf(out, " %d:%" PRIu64 ":%.9g", i, n,
+                    yavalath_ai_get_move_score(buf, i) * n);
+    }
+    fputc('\n', out);
+    fflush(out);
+}
+
+static void
+worker_search(void *buf, FILE *out, uint64_t msecs, uint64_t interval)
+{
+    uint64_t now = os_uepoch();
+    uint64_t deadline = now + msecs * 1000;
+    uint64_t report = now + interval * 1000;
+    enum yavalath_result r = YAVALATH_SUCCESS;
+    while (r == YAVALATH_SUCCESS && now < deadline) {
+        r = yavalath_ai_playout(buf, SLICE);
+        now = os_uepoch();
+        if (now >= report) {
+            worker_report(buf, out);
+            report = now + interval * 1000;
+        }
+    }
+    worker_report(buf, out);
+    fputs("done\n", out);
+    fflush(out);
+}
+
+static int
+worker(char *addr, size_t size)
+{
+    int fd = tcp_connect(addr);
+    if (fd == -1) {
+        fprintf(stderr, "yavalath-dist: could not reach coordinator\n");
+        return -1;
+    }
+    tcp_nodelay(fd);
+    FILE *in = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    void *buf = os_alloc(size, 0);
+    if (!in || !out || !buf) {
+        fprintf(stderr, "yavalath-dist: out of memory\n");
+        return -1;
+    }
+    yavalath_ai_init_zeroed(buf, size, 0, 0, 0);
+
+    char line[256];
+    while (fgets(line, sizeof(line), in)) {
+        char cmd[16] = "";
+        uint64_t a = 0;
+        uint64_t b = 0;
+        sscanf(line, "%15s %" SCNu64 " %" SCNu64, cmd, &a, &b);
+        if (!strcmp(cmd, "new")) {
+            yavalath_ai_init(buf, size, 0, 0, a);
+        } else if (!strcmp(cmd, "play")) {
+            if (a >= YAVALATH_CELLS ||
+                yavalath_ai_advance(buf, a) != YAVALATH_SUCCESS) {
+                fprintf(out, "error bad-move %" PRIu64 "\n", a);
+                fflush(out);
+                continue;
+            }
+            yavalath_ai_compact(buf);
+        } else if (!strcmp(cmd, "go")) {
+            worker_search(buf, out, a, b);
+        } else if (!strcmp(cmd, "quit")) {
+            break;
+        }
+    }
+    os_free(buf, size);
+    fclose(in);
+    fclose(out);
+    return 0;
+}
+
+/* Coordinator */
+
+static void
+peer_drop(struct peer *p)
+{
+    if (p->fd != -1) {
+        close(p->fd);
+        p->fd = -1;
+        fprintf(stderr, "yavalath-dist: lost worker %d\n", (int)(p - peers));
+    }
+}
+
+static void
+peer_send(struct peer *p, const char *fmt, ...)
+{
+    char line[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+    va_end(ap);
+    line[len++] = '\n';
+    for (int off = 0; p->fd != -1 && off < len;) {
+        ssize_t r = write(p->fd, line + off, len - off);
+        if (r <= 0)
+            peer_drop(p);
+        else
+            off += r;
+    }
+}
+
+static void
+peer_clear(struct peer *p)
+{
+    p->total = 0;
+    memset(p->playouts, 0, sizeof(p->playouts));
+    memset(p->reward, 0, sizeof(p->reward));
+}
+
+static void
+peer_stats(struct peer *p, char *line)
+{
+    char *save;
+    char *tok = strtok_r(line, " ", &save);  // "stats"
+    tok = strtok_r(0, " ", &save);
+    if (!tok)
+        return;
+    peer_clear(p);
+    p->total = strtoull(tok, 0, 10);
+    while ((tok = strtok_r(0, " ", &save))) {
+        int bit;
+        uint64_t n;
+        double reward;
+        if (sscanf(tok, "%d:%" SCNu64 ":%lf", &bit, &n, &reward) == 3 &&
+            bit >= 0 && bit < YAVALATH_CELLS) {
+            p->playouts[bit] = n;
+            p->reward[bit] = reward;
+        }
+    }
+}
+
+/* Read what is available from a worker and handle complete lines. */
+static void
+peer_read(struct peer *p)
+{
+    ssize_t r = read(p->fd, p->buf + p->len, sizeof(p->buf) - p->len - 1);
+    if (r <= 0) {
+        peer_drop(p);
+        return;
+    }
+    p->len += r;
+    p->buf[p->len] = 0;
+    char *line = p->buf;
+    char *end;
+    while ((end = strchr(line, '\n'))) {
+        *end = 0;
+        if (!strncmp(line, "stats ", 6)) {
+            peer_stats(p, line);
+        } else if (!strcmp(line, "done")) {
+            p->done = 1;
+        } else if (!strncmp(line, "error ", 6)) {
+            fprintf(stderr, "yavalath-dist: worker %d: %s\n",
+                    (int)(p - peers), line);
+            peer_drop(p);
+            p->len = 0;
+            return;
+        }
+        line = end + 1;
+    }
+    p->len -= line - p->buf;
+    memmove(p->buf, line, p->len);
+    if (p->len == sizeof(p->buf) - 1)
+        peer_drop(p);  // runaway line
+}
+
+static int
+peers_live(void)
+{
+    int n = 0;
+    for (int i = 0; i < npeers; i++)
+        n += peers[i].fd != -1;
+    return n;
+}
+
+/* Combine every worker's root statistics and pick the best mean. */
+static int
+merged_best(uint64_t *total, double *score)
+{
+    uint64_t playouts[YAVALATH_CELLS] = {0};
+    double reward[YAVALATH_CELLS] = {0};
+    *total = 0;
+    for (int i = 0; i < npeers; i++) {
+        *total += peers[i].total;
+        for (int j = 0; j < YAVALATH_CELLS; j++) {
+            playouts[j] += peers[i].playouts[j];
+            reward[j] += peers[i].reward[j];
+        }
+    }
+    int best = -1;
+    double best_mean = 0;
+    for (int j = 0; j < YAVALATH_CELLS; j++) {
+        if (!playouts[j])
+            continue;
+        double mean = reward[j] / playouts[j];
+        if (best == -1 || mean > best_mean ||
+            (mean == best_mean && playouts[j] > playouts[best])) {
+            best = j;
+            best_mean = mean;
+        }
+    }
+    *score = best_mean;
+    return best;
+}
+
+static void
+coord_info(uint64_t usecs)
+{
+    uint64_t total;
+    double score;
+    int best = merged_best(&total, &score);
+    char move[YAVALATH_NOTATION_MAX] = "--";
+    if (best != -1)
+        yavalath_bit_to_notation(move, best);
+    printf("info workers %d playouts %" PRIu64 " time %" PRIu64
+           " best %s score %.4f\n",
+           peers_live(), total, usecs / 1000, move, score);
+    fflush(stdout);
+}
+
+static void
+coord_go(uint64_t msecs)
+{
+    uint64_t start = os_uepoch();
+    uint64_t giveup = start + (msecs + GRACE_MSEC) * 1000;
+    uint64_t last_info = start;
+    for (int i = 0; i < npeers; i++) {
+        peers[i].done = 0;
+        peer_send(peers + i, "go %" PRIu64 " %d", msecs, REPORT_MSEC);
+    }
+
+    struct pollfd *fds = calloc(npeers, sizeof(*fds));
+    for (;;) {
+        int pending = 0;
+        for (int i = 0; i < npeers; i++) {
+            fds[i].fd = peers[i].done ? -1 : peers[i].fd;
+            fds[i].events = POLLIN;
+            pending += fds[i].fd != -1;
+        }
+        if (!pending)
+            break;
+        uint64_t now = os_uepoch();
+        if (now >= giveup) {
+            for (int i = 0; i < npeers; i++)
+                if (!peers[i].done)
+                    peer_drop(peers + i);
+            break;
+        }
+        if (poll(fds, npeers, REPORT_MSEC) > 0)
+            for (int i = 0; i < npeers; i++)
+                if (fds[i].revents)
+                    peer_read(peers + i);
+        now = os_uepoch();
+        if (now - last_info >= REPORT_MSEC * 1000) {
+            coord_info(now - start);
+            last_info = now;
+        }
+    }
+    free(fds);
+
+    coord_info(os_uepoch() - start);
+    uint64_t total;
+    double score;
+    int best = merged_best(&total, &score);
+    char move[YAVALATH_NOTATION_MAX] = "--";
+    if (best != -1)
+        yavalath_bit_to_notation(move, best);
+    printf("bestmove %s %.4f %" PRIu64 "\n", move, score, total);
+    fflush(stdout);
+}
+
+static int
+coordinator(char *addr, int nworkers, uint64_t seed, uint64_t timeout)
+{
+    int listener = tcp_listen(addr);
+    if (listener == -1) {
+        perror("yavalath-dist");
+        return -1;
+    }
+    peers = calloc(nworkers, sizeof(*peers));
+    if (!peers) {
+        fprintf(stderr, "yavalath-dist: out of memory\n");
+        return -1;
+    }
+    fprintf(stderr, "yavalath-dist: waiting for %d workers\n", nworkers);
+    while (npeers < nworkers) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd == -1)
+            continue;
+        tcp_nodelay(fd);
+        peers[npeers++].fd = fd;
+    }
+    close(listener);
+    fprintf(stderr, "yavalath-dist: %d workers connected\n", npeers);
+
+    yavalath_bitboard board[2] = {0, 0};
+    int turn = 0;
+    int over = 0;
+    for (int i = 0; i < npeers; i++)
+        peer_send(peers + i, "new %" PRIu64, seed + i);
+
+    char line[256];
+    while (fgets(line, sizeof(line), stdin)) {
+        char cmd[16] = "", a[32] = "";
+        if (sscanf(line, "%15s %31s", cmd, a) < 1)
+            continue;
+        if (!strcmp(cmd, "quit")) {
+            break;
+        } else if (!strcmp(cmd, "workers")) {
+            printf("workers %d\n", peers_live());
+        } else if (!strcmp(cmd, "new")) {
+            board[0] = board[1] = 0;
+            turn = over = 0;
+            seed += npeers;
+            for (int i = 0; i < npeers; i++) {
+                peer_clear(peers + i);
+                peer_send(peers + i, "new %" PRIu64, seed + i);
+            }
+            printf("ok new\n");
+        } else if (!strcmp(cmd, "play")) {
+            static const char *names[] = {"", " win", " loss", " draw"};
+            int bit = yavalath_notation_to_bit(a);
+            if (over || bit == -1 || (((board[0] | board[1]) >> bit) & 1)) {
+                printf("error bad-move %s\n", a);
+            } else {
+                for (int i = 0; i < npeers; i++) {
+                    peer_clear(peers + i);
+                    peer_send(peers + i, "play %d", bit);
+                }
+                board[turn] |= YAVALATH_BIT(bit);
+                enum yavalath_game_result result =
+                    yavalath_check(board[turn], board[!turn], bit, 0);
+                over = result != YAVALATH_GAME_UNRESOLVED;
+                turn = !turn;
+                printf("ok play%s\n", names[result]);
+            }
+        } else if (!strcmp(cmd, "go")) {
+            if (over)
+                printf("error game-over\n");
+            else if (!peers_live())
+                printf("error no-workers\n");
+            else
+                coord_go(*a ? strtoull(a, 0, 10) : timeout);
+        } else {
+            printf("error unknown-command %s\n", cmd);
+        }
+        fflush(stdout);
+    }
+    for (int i = 0; i < npeers; i++)
+        peer_send(peers + i, "quit");
+    return 0;
+}
+
+static void
+print_usage(void)
+{
+    printf("yavalath-dist [options]\n");
+    printf("  -l<[host:]port> Coordinate workers, listening on port\n");
+    printf("  -n<workers>     Number of workers to wait for (1)\n");
+    printf("  -t<msecs>       Default search time per go (%lu)\n",
+           TIMEOUT_MSEC);
+    printf("  -s<seed>        Seed for the first worker (time)\n");
+    printf("  -w<host:port>   Run as a worker of the given coordinator\n");
+    printf("  -m<MB>          Worker AI buffer size in megabytes (%d)\n",
+           BUFFER_MB);
+    printf("  -h              Print this help text\n");
+    printf("\nFor example, a coordinator with two local workers:\n");
+    printf("  $ yavalath-dist -l7777 -n2 &\n");
+    printf("  $ yavalath-dist -wlocalhost:7777 & "
+           "yavalath-dist -wlocalhost:7777 &\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    char *listen_addr = NULL;
+    char *worker_addr = NULL;
+    int nworkers = 1;
+    uint64_t timeout = TIMEOUT_MSEC;
+    uint64_t seed = os_uepoch();
+    size_t size = (size_t)BUFFER_MB << 20;
+
+    for (int i = 1; i < argc; i++) {
+        char *p = argv[i] + 1;
+        if (argv[i][0] != '-')
+            goto fail;
+        if (*p != 'h' && !p[1])
+            goto missing;
+        switch (*p) {
+            case 'l':
+                listen_addr = p + 1;
+                break;
+            case 'n':
+                nworkers = strtol(p + 1, 0, 10);
+                break;
+            case 't':
+                timeout = strtoull(p + 1, 0, 10);
+                break;
+            case 's':
+                seed = strtoull(p + 1, 0, 10);
+                break;
+            case 'w':
+                worker_addr = p + 1;
+                break;
+            case 'm':
+                size = strtoull(p + 1, 0, 10) << 20;
+                break;
+            case 'h':
+                print_usage();
+                exit(0);
+            default:
+                goto fail;
+        }
+        continue;
+  missing:
+        fprintf(stderr, "yavalath-dist: missing argument, %s\n", argv[i]);
+        exit(-1);
+  fail:
+        fprintf(stderr, "yavalath-dist: bad argument, %s\n", argv[i]);
+        exit(-1);
+    }
+
+    signal(SIGPIPE, SIG_IGN);  // lost peers are noticed by write()
+    if (worker_addr)
+        return worker(worker_addr, size);
+    if (listen_addr && nworkers > 0)
+        return coordinator(listen_addr, nworkers, seed, timeout);
+    print_usage();
+    return -1;
+}
@@ -0,0 +1,287 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include "os.h"
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/syscall.h>
+
+uint64_t
+os_uepoch(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return UINT64_C(1000000) * tv.tv_sec + tv.tv_usec;
+}
+
+size_t
+os_physical_memory(void)
+{
+    size_t pages = sysconf(_SC_PHYS_PAGES);
+    size_t page_size = sysconf(_SC_PAGE_SIZE);
+    return pages * page_size;
+}
+
+int
+os_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : n;
+}
+
+/* Sizes are rounded so that explicit huge page mappings can be freed
+ * with the same size that was requested.
+ */
+#define OS_HUGE_PAGE ((size_t)2 << 20)
+
+static size_t
+os_round(size_t size)
+{
+    return (size + OS_HUGE_PAGE - 1) & ~(OS_HUGE_PAGE - 1);
+}
+
+void *
+os_alloc(size_t size, int flags)
+{
+    int prot = PROT_READ | PROT_WRITE;
+    int map = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *p = MAP_FAILED;
+    size = os_round(size);
+#ifdef MAP_NORESERVE
+    if (flags & OS_ALLOC_RESERVE)
+        map |= MAP_NORESERVE;
+#endif
+#ifdef MAP_HUGETLB
+    if (flags & OS_ALLOC_HUGE)
+        p = mmap(0, size, prot, map | MAP_HUGETLB, -1, 0);
+#endif
+    if (p == MAP_FAILED) {
+        p = mmap(0, size, prot, map, -1, 0);
+        if (p == MAP_FAILED)
+            return NULL;
+#ifdef MADV_HUGEPAGE
+        if (flags & OS_ALLOC_HUGE)
+            madvise(p, size, MADV_HUGEPAGE);
+#endif
+    }
+    return p;
+}
+
+int
+os_numa(void *p, size_t size, int node)
+{
+#ifdef SYS_mbind
+    enum {MPOL_BIND_ = 2, MPOL_INTERLEAVE_ = 3};
+    unsigned long mask = node < 0 ? -1UL : 1UL << node;
+    int mode = node < 0 ? MPOL_INTERLEAVE_ : MPOL_BIND_;
+    unsigned long maxnode = sizeof(mask) * 8;
+    if (node >= (int)maxnode)
+        return 0;
+    return !syscall(SYS_mbind, p, os_round(size), mode, &mask, maxnode, 0);
+#else
+    (void)p;
+    (void)size;
+    (void)node;
+    return 0;
+#endif
+}
+
+void
+os_free(void *p, size_t size)
+{
+    munmap(p, os_round(size));
+}
+
+void *
+os_realloc(void *p, size_t old_size, size_t new_size, int flags)
+{
+#ifdef MREMAP_MAYMOVE
+    void *q = mremap(p, os_round(old_size), os_round(new_size),
+                     MREMAP_MAYMOVE);
+    if (q != MAP_FAILED)
+        return q;
+#endif
+    void *r = os_alloc(new_size, flags);
+    if (r) {
+        memcpy(r, p, old_size < new_size ? old_size : new_size);
+        os_free(p, old_size);
+    }
+    return r;
+}
+
+void
+os_discard(void *p, size_t size)
+{
+    madvise(p, size, MADV_DONTNEED);
+}
+
+void *
+os_shm_open(const char *name, size_t *size)
+{
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd != -1) {
+        if (ftruncate(fd, *size)) {
+            close(fd);
+            shm_unlink(name);
+            return 0;
+        }
+    } else {
+        /* Wait briefly for another creator to size the region. */
+        fd = shm_open(name, O_RDWR, 0);
+        struct stat st;
+        for (int tries = 0; fd != -1; tries++) {
+            if (fstat(fd, &st) || (!st.st_size && tries == 100)) {
+                close(fd);
+                return 0;
+            }
+            if (st.st_size)
+                break;
+            usleep(10000);
+        }
+        if (fd == -1)
+            return 0;
+        *size = st.st_size;
+    }
+    void *p = mmap(0, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? 0 : p;
+}
+
+void
+os_shm_close(void *p, size_t size)
+{
+    munmap(p, size);
+}
+
+int
+os_input_ready(void)
+{
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(0, &set);
+    struct timeval timeout = {0, 0};
+    return select(1, &set, 0, 0, &timeout) > 0;
+}
+
+#elif _WIN32
+#include <windows.h>
+
+uint64_t
+os_uepoch(void)
+{
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    uint64_t tt = ft.dwHighDateTime;
+    tt <<= 32;
+    tt |= ft.dwLowDateTime;
+    tt /=10;
+    tt -= UINT64_C(11644473600000000);
+    return tt;
+}
+
+size_t
+os_physical_memory(void)
+{
+    MEMORYSTATUSEX status = {.dwLength = sizeof(status)};
+    GlobalMemoryStatusEx(&status);
+    return status.ullTotalPhys;
+}
+
+int
+os_cpu_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+}
+
+void *
+os_alloc(size_t size, int flags)
+{
+    DWORD type = MEM_COMMIT | MEM_RESERVE;
+    size_t large = GetLargePageMinimum();
+    if ((flags & OS_ALLOC_HUGE) && large) {
+        size_t rounded = (size + large - 1) & ~(large - 1);
+        void *p = VirtualAlloc(0, rounded, type | MEM_LARGE_PAGES,
+                               PAGE_READWRITE);
+        if (p)
+            return p;
+    }
+    return VirtualAlloc(0, size, type, PAGE_READWRITE);
+}
+
+void *
+os_realloc(void *p, size_t old_size, size_t new_size, int flags)
+{
+    void *r = os_alloc(new_size, flags);
+    if (r) {
+        memcpy(r, p, old_size < new_size ? old_size : new_size);
+        os_free(p, old_size);
+    }
+    return r;
+}
+
+int
+os_numa(void *p, size_t size, int node)
+{
+    (void)p;
+    (void)size;
+    (void)node;
+    return 0;
+}
+
+void
+os_free(void *p, size_t size)
+{
+    (void)size;
+    VirtualFree(p, 0, MEM_RELEASE);
+}
+
+void
+os_discard(void *p, size_t size)
+{
+    VirtualFree(p, size, MEM_DECOMMIT);
+    VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE);
+}
+
+void *
+os_shm_open(const char *name, size_t *size)
+{
+    uint64_t n = *size;
+    HANDLE h = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE,
+                                  n >> 32, n & 0xffffffff, name);
+    if (!h)
+        return 0;
+    void *p = MapViewOfFile(h, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    CloseHandle(h);  // the view keeps the mapping alive
+    if (p) {
+        MEMORY_BASIC_INFORMATION info;
+        if (VirtualQuery(p, &info, sizeof(info)))
+            *size = info.RegionSize;
+    }
+    return p;
+}
+
+void
+os_shm_close(void *p, size_t size)
+{
+    (void)size;
+    UnmapViewOfFile(p);
+}
+
+int
+os_input_ready(void)
+{
+    HANDLE in = GetStdHandle(STD_INPUT_HANDLE);
+    DWORD avail;
+    if (GetFileType(in) == FILE_TYPE_PIPE)
+        return PeekNamedPipe(in, 0, 0, 0, &avail, 0) && avail;
+    return WaitForSingleObject(in, 0) == WAIT_OBJECT_0;
+}
+#endif
@@ -0,0 +1,102 @@
+/**
+ * Minimal platform layer shared by the Yavalath frontends.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Return the current wall clock time in microseconds.
+ */
+uint64_t
+os_uepoch(void);
+
+/**
+ * Return the total amount of physical memory in bytes.
+ */
+size_t
+os_physical_memory(void);
+
+/**
+ * Return the number of online processors.
+ */
+int
+os_cpu_count(void);
+
+enum os_alloc_flags {
+    OS_ALLOC_HUGE = 1 << 0,     // back with huge pages when possible
+    OS_ALLOC_RESERVE = 1 << 1,  // only charge pages once touched
+};
+
+/**
+ * Allocate a large, page-aligned, zero-filled region.
+ *
+ * With OS_ALLOC_HUGE, explicit huge pages are tried first, then
+ * transparent huge pages, and finally ordinary pages. With
+ * OS_ALLOC_RESERVE, where supported, the region may be larger than
+ * memory and swap, since pages are only accounted for once touched.
+ * Returns NULL on failure. The region must be released with
+ * `os_free()` using the same size.
+ */
+void *
+os_alloc(size_t size, int flags);
+
+/**
+ * Resize a region allocated by `os_alloc()`, preserving its contents.
+ *
+ * The region may move. Any newly added range is zero-filled. Returns
+ * NULL on failure, in which case the original region is untouched.
+ */
+void *
+os_realloc(void *p, size_t old_size, size_t new_size, int flags);
+
+/**
+ * Set the NUMA placement of a region before it is first touched.
+ *
+ * A negative node interleaves pages across all nodes, otherwise pages
+ * are bound to the given node. Returns 0 if unsupported or failed, in
+ * which case the default placement remains.
+ */
+int
+os_numa(void *p, size_t size, int node);
+
+/**
+ * Release a region allocated by `os_alloc()`.
+ */
+void
+os_free(void *p, size_t size);
+
+/**
+ * Return the pages of part of a region to the operating system.
+ *
+ * The range remains usable and reads back as zeros, just as when it
+ * was first allocated. The pointer and size should be page aligned.
+ */
+void
+os_discard(void *p, size_t size);
+
+/**
+ * Return non-zero if standard input can be read without blocking.
+ *
+ * Standard input should be unbuffered so that no lines are hidden
+ * away in the stdio buffer.
+ */
+int
+os_input_ready(void);
+
+/**
+ * Map a named shared memory region, creating it if needed.
+ *
+ * A new region is zero-filled and *size bytes long. When the region
+ * already exists, its own size is used and stored in *size. The name
+ * should start with a slash. Returns NULL on failure. The mapping must
+ * be released with `os_shm_close()`.
+ */
+void *
+os_shm_open(const char *name, size_t *size);
+
+/**
+ * Unmap a region mapped by `os_shm_open()`. The region itself lives on
+ * until the system removes it (e.g. with `rm /dev/shm/<name>`).
+ */
+void
+os_shm_close(void *p, size_t size);
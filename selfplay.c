@@ -0,0 +1,629 @@
+/**
+ * Yavalath self-play data generator
+ *
+ * Plays games against itself on every core, one AI buffer per worker
+ * thread, and records each searched position with the root statistics
+ * and the game's final result, as training data for an evaluator.
+ * Games are played until the requested number is reached or until
+ * interrupted, after which everything finished so far is written out.
+ *
+ * Output goes to numbered shards, "<prefix>-00000.yvs" and so on, each
+ * with an index "<prefix>-00000.yvi". A new run never overwrites
+ * shards, it starts at the first unused number. Files are append-only
+ * and little-endian, and records have a fixed size, so a shard can be
+ * memory mapped and read as an array.
+ *
+ * Shard: a 16-byte header, "YAVS", version 1, the number of cells, the
+ * record size (16 bits), and 8 zero bytes, followed by records:
+ *
+ *   u64 stones[2][W]    side to move first, W = (cells + 63) / 64
+ *   u8  ply             stones on the board
+ *   u8  turn            player to move, 0 or 1
+ *   i8  result          to the side to move: 1 win, -1 loss, 0 draw
+ *   u8  reserved
+ *   u32 playouts        playouts at the root
+ *   u32 visits[cells]   root playouts of each move
+ *   f32 scores[cells]   mean reward of each move to the side to move
+ *
+ * Index: a 16-byte header, "YAVI", version 1, then 11 zero bytes,
+ * followed by 16 bytes per game:
+ *
+ *   u64 first           shard record number of its first position
+ *   u32 count           positions recorded
+ *   u8  plies           moves in the whole game
+ *   i8  result          to player 0: 1 win, -1 loss, 0 draw
+ *   u16 reserved
+ *
+ * A game's index entry is written after its records, so every entry
+ * refers to complete data even if the run is cut short.
+ *
+ * Workers never write files themselves. Finished games are copied into
+ * the front half of a double buffer, which a writer thread takes over
+ * once it is full, or has waited too long, while workers go on filling
+ * the other half.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include "yavalath.h"
+#include "weights.h"
+#include "os.h"
+
+#define PLAYOUTS    10000
+#define OPENING     2
+#define BUFFER_MB   256
+#define SHARD_MB    1024
+#define MIX         0.5
+#define BATCH_MB    4
+#define FLUSH_SECS  30              // longest a finished game waits
+#define NAME_MAX_LEN 4096
+
+#define WORDS       ((YAVALATH_CELLS + 63) / 64)
+#define RECORD_SIZE (WORDS * 16 + 8 + YAVALATH_CELLS * 8)
+#define HEADER_SIZE 16
+#define INDEX_SIZE  16
+
+struct game {
+    int nrecords;
+    int plies;
+    int result;                     // to player 0
+};
+
+/* One half of the output double buffer. */
+struct batch {
+    unsigned char *data;            // records, game after game
+    size_t len;
+    struct game *games;
+    int ngames;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;           // a batch awaits the writer
+    pthread_cond_t written;         // the writer is idle again
+    struct batch batches[2];
+    int front;                      // batch being filled
+    int busy;                       // the other batch awaits writing
+    int finished;                   // no more games are coming
+    uint64_t swapped;               // time of the last hand-over
+    size_t cap;                     // bytes per batch
+    int max_games;                  // games per batch
+} out = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .ready = PTHREAD_COND_INITIALIZER,
+    .written = PTHREAD_COND_INITIALIZER,
+};
+
+struct selfplay {
+    size_t size;                    // AI buffer size per worker
+    uint32_t playouts;
+    int opening;
+    const float *weights;           // or NULL
+    float mix;
+    uint64_t seed;
+    long max_games;                 // 0 to play until interrupted
+    long started;
+    uint64_t games;                 // finished and handed over
+    uint64_t positions;
+    pthread_mutex_t lock;
+};
+
+static volatile sig_atomic_t interrupted;
+
+static void
+on_interrupt(int sig)
+{
+    (void)sig;
+    interrupted = 1;
+}
+
+static uint64_t
+xorshift64(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static void
+put16(unsigned char *p, uint16_t x)
+{
+    p[0] = x;
+    p[1] = x >> 8;
+}
+
+static void
+put32(unsigned char *p, uint32_t x)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = x >> (i * 8);
+}
+
+static void
+put64(unsigned char *p, uint64_t x)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = x >> (i * 8);
+}
+
+static void
+put_bitboard(unsigned char *p, yavalath_bitboard x)
+{
+#if YAVALATH_CELLS > 64
+    put64(p, x);
+    put64(p + 8, x >> 64);
+#else
+    put64(p, x);
+#endif
+}
+
+static int
+random_move(yavalath_bitboard taken, uint64_t *rng)
+{
+    int options[YAVALATH_CELLS];
+    int noptions = 0;
+    for (int i = 0; i < YAVALATH_CELLS; i++)
+        if (!((taken >> i) & 1))
+            options[noptions++] = i;
+    return options[xorshift64(rng) % noptions];
+}
+
+/* Encode the searched root of buf, with the result left for later. */
+static void
+encode_record(unsigned char *p, void *buf, const yavalath_bitboard board[2],
+              int turn, int ply)
+{
+    unsigned char *q = p;
+    put_bitboard(q, board[turn]);
+    put_bitboard(q + WORDS * 8, board[!turn]);
+    q += WORDS * 16;
+    q[0] = ply;
+    q[1] = turn;
+    q[2] = 0;
+    q[3] = 0;
+    put32(q + 4, yavalath_ai_get_total_playouts(buf));
+    q += 8;
+    for (int i = 0; i < YAVALATH_CELLS; i++) {
+        uint32_t visits = yavalath_ai_get_move_playouts(buf, i);
+        float score = yavalath_ai_get_move_score(buf, i);
+        uint32_t bits;
+        memcpy(&bits, &score, sizeof(bits));
+        put32(q + i * 4, visits);
+        put32(q + YAVALATH_CELLS * 4 + i * 4, bits);
+    }
+}
+
+/* Hand the front batch to the writer. Called with the lock held. */
+static void
+swap_batches(void)
+{
+    out.busy = 1;
+    out.front = !out.front;
+    out.swapped = os_uepoch();
+    pthread_cond_signal(&out.ready);
+}
+
+/* Copy a finished game into the front batch, waiting only when both
+ * batches are full.
+ */
+static void
+submit_game(const unsigned char *records, const struct game *game)
+{
+    size_t len = (size_t)game->nrecords * RECORD_SIZE;
+    pthread_mutex_lock(&out.lock);
+    for (;;) {
+        struct batch *b = out.batches + out.front;
+        if (b->len + len <= out.cap && b->ngames < out.max_games)
+            break;
+        if (!out.busy)
+            swap_batches();
+        else
+            pthread_cond_wait(&out.written, &out.lock);
+    }
+    struct batch *b = out.batches + out.front;
+    memcpy(b->data + b->len, records, len);
+    b->len += len;
+    b->games[b->ngames++] = *game;
+    if (!out.busy && os_uepoch() - out.swapped >= FLUSH_SECS * 1000000ULL)
+        swap_batches();
+    pthread_mutex_unlock(&out.lock);
+}
+
+/* Play one game and submit it. Returns 0 if interrupted midway. */
+static int
+play_game(void *buf, const struct selfplay *s, unsigned char *records,
+          uint64_t seed, uint64_t *positions)
+{
+    uint64_t rng = seed ? seed : 1;
+    yavalath_bitboard board[2] = {0, 0};
+    int turn = 0;
+    int nrecords = 0;
+    enum yavalath_game_result result;
+    yavalath_ai_init(buf, s->size, 0, 0, seed);
+    if (s->weights)
+        yavalath_ai_set_evaluator(buf, s->weights, s->mix);
+    for (int ply = 0;; ply++) {
+        if (interrupted)
+            return 0;
+        int bit;
+        if (ply < s->opening) {
+            bit = random_move(board[0] | board[1], &rng);
+        } else {
+            yavalath_ai_playout(buf, s->playouts);
+            if (yavalath_ai_get_total_playouts(buf)) {
+                encode_record(records + (size_t)nrecords++ * RECORD_SIZE,
+                              buf, board, turn, ply);
+                bit = yavalath_ai_best_move(buf);
+            } else {
+                bit = random_move(board[0] | board[1], &rng);
+            }
+        }
+        yavalath_ai_advance(buf, bit);
+        yavalath_ai_compact(buf);
+        board[turn] |= YAVALATH_BIT(bit);
+        result = yavalath_check(board[turn], board[!turn], bit, 0);
+        if (result != YAVALATH_GAME_UNRESOLVED)
+            break;
+        turn = !turn;
+    }
+
+    /* Fill in each position's result for its side to move. */
+    int winner = result == YAVALATH_GAME_WIN  ? turn :
+                 result == YAVALATH_GAME_LOSS ? !turn : -1;
+    for (int i = 0; i < nrecords; i++) {
+        unsigned char *p = records + (size_t)i * RECORD_SIZE + WORDS * 16;
+        p[2] = winner == -1 ? 0 : winner == p[1] ? 1 : -1;
+    }
+    int plies = 0;
+    for (int i = 0; i < YAVALATH_CELLS; i++)
+        plies += ((board[0] | board[1]) >> i) & 1;
+    struct game game = {
+        .nrecords = nrecords,
+        .plies = plies,
+        .result = winner == -1 ? 0 : winner == 0 ? 1 : -1,
+    };
+    submit_game(records, &game);
+    *positions = nrecords;
+    return 1;
+}
+
+static void *
+worker(void *arg)
+{
+    struct selfplay *s = arg;
+    void *buf = os_alloc(s->size, 0);
+    unsigned char *records = malloc((size_t)YAVALATH_CELLS * RECORD_SIZE);
+    if (!buf || !records) {
+        fprintf(stderr, "yavalath-selfplay: out of memory\n");
+        exit(-1);
+    }
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        long g = s->started;
+        int done = interrupted || (s->max_games && g >= s->max_games);
+        s->started += !done;
+        pthread_mutex_unlock(&s->lock);
+        if (done)
+            break;
+        uint64_t positions;
+        if (!play_game(buf, s, records, s->seed + g, &positions))
+            break;
+        pthread_mutex_lock(&s->lock);
+        s->games++;
+        s->positions += positions;
+        pthread_mutex_unlock(&s->lock);
+    }
+    free(records);
+    os_free(buf, s->size);
+    return NULL;
+}
+
+/* Output files, and the writer thread that feeds them. */
+static struct {
+    const char *prefix;
+    int number;                     // current shard
+    FILE *data;
+    FILE *index;
+    uint64_t records;               // in the current shard
+    uint64_t max_records;
+} shard;
+
+static void
+write_or_die(const void *p, size_t len, FILE *f)
+{
+    if (fwrite(p, len, 1, f) != 1 || ferror(f)) {
+        fprintf(stderr, "yavalath-selfplay: error writing shard %05d\n",
+                shard.number);
+        exit(-1);
+    }
+}
+
+static void
+shard_name(char *name, int number, const char *suffix)
+{
+    snprintf(name, NAME_MAX_LEN, "%s-%05d.%s", shard.prefix, number, suffix);
+}
+
+static int
+shard_exists(int number)
+{
+    char name[NAME_MAX_LEN];
+    for (int i = 0; i < 2; i++) {
+        shard_name(name, number, i ? "yvi" : "yvs");
+        FILE *f = fopen(name, "rb");
+        if (f) {
+            fclose(f);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void
+shard_close(void)
+{
+    if (shard.data && (fclose(shard.data) || fclose(shard.index))) {
+        fprintf(stderr, "yavalath-selfplay: error closing shard %05d\n",
+                shard.number);
+        exit(-1);
+    }
+    shard.data = shard.index = NULL;
+}
+
+/* Start the next unused shard. */
+static void
+shard_open(void)
+{
+    shard_close();
+    while (shard_exists(shard.number))
+        shard.number++;
+    char name[2][NAME_MAX_LEN];
+    shard_name(name[0], shard.number, "yvs");
+    shard_name(name[1], shard.number, "yvi");
+    shard.data = fopen(name[0], "wb");
+    shard.index = shard.data ? fopen(name[1], "wb") : NULL;
+    if (!shard.index) {
+        fprintf(stderr, "yavalath-selfplay: cannot create %s\n",
+                shard.data ? name[1] : name[0]);
+        exit(-1);
+    }
+    setvbuf(shard.data, NULL, _IOFBF, 1 << 20);
+    shard.records = 0;
+
+    unsigned char header[HEADER_SIZE] = {'Y', 'A', 'V', 'S', 1};
+    header[5] = YAVALATH_CELLS;
+    put16(header + 6, RECORD_SIZE);
+    write_or_die(header, sizeof(header), shard.data);
+    memcpy(header, "YAVI", 4);
+    memset(header + 5, 0, sizeof(header) - 5);
+    write_or_die(header, sizeof(header), shard.index);
+}
+
+static void
+write_batch(struct batch *b)
+{
+    const unsigned char *p = b->data;
+    for (int i = 0; i < b->ngames; i++) {
+        const struct game *g = b->games + i;
+        if (!shard.data || shard.records >= shard.max_records)
+            shard_open();
+        size_t len = (size_t)g->nrecords * RECORD_SIZE;
+        write_or_die(p, len, shard.data);
+        p += len;
+
+        unsigned char entry[INDEX_SIZE] = {0};
+        put64(entry, shard.records);
+        put32(entry + 8, g->nrecords);
+        entry[12] = g->plies;
+        entry[13] = g->result;
+        write_or_die(entry, sizeof(entry), shard.index);
+        shard.records += g->nrecords;
+    }
+    /* Records must reach the file before the index refers to them. */
+    if (shard.data && (fflush(shard.data) || fflush(shard.index))) {
+        fprintf(stderr, "yavalath-selfplay: error writing shard %05d\n",
+                shard.number);
+        exit(-1);
+    }
+    b->len = 0;
+    b->ngames = 0;
+}
+
+static void *
+writer(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&out.lock);
+    for (;;) {
+        while (!out.busy && !out.finished)
+            pthread_cond_wait(&out.ready, &out.lock);
+        if (!out.busy) {
+            /* Workers are gone, so the front batch is ours too. */
+            write_batch(out.batches + out.front);
+            break;
+        }
+        struct batch *b = out.batches + !out.front;
+        pthread_mutex_unlock(&out.lock);
+        write_batch(b);
+        pthread_mutex_lock(&out.lock);
+        out.busy = 0;
+        pthread_cond_broadcast(&out.written);
+    }
+    pthread_mutex_unlock(&out.lock);
+    shard_close();
+    return NULL;
+}
+
+static void
+print_status(struct selfplay *s, uint64_t start)
+{
+    pthread_mutex_lock(&s->lock);
+    uint64_t games = s->games;
+    uint64_t positions = s->positions;
+    pthread_mutex_unlock(&s->lock);
+    double secs = (os_uepoch() - start) / 1e6;
+    double rate = secs > 0 ? positions / secs : 0;
+    fprintf(stderr, "\r%" PRIu64 " games, %" PRIu64 " positions, "
+            "%.0f positions/s (%.2fM/day)", games, positions, rate,
+            rate * 86400 / 1e6);
+}
+
+static void
+print_usage(void)
+{
+    printf("yavalath-selfplay -o<prefix> [options]\n");
+    printf("  -o<prefix>    Write shards <prefix>-NNNNN.yvs and .yvi\n");
+    printf("  -g<games>     Stop after this many games (until interrupted)\n");
+    printf("  -p<playouts>  Playouts per move (%d)\n", PLAYOUTS);
+    printf("  -r<moves>     Random opening moves per game (%d)\n", OPENING);
+    printf("  -j<threads>   Number of worker threads (ncpu)\n");
+    printf("  -m<MB>        AI buffer size per thread in megabytes (%d)\n",
+           BUFFER_MB);
+    printf("  -S<MB>        Start a new shard past this size (%d)\n",
+           SHARD_MB);
+    printf("  -w<file>      Evaluate leaves with weights from yavalath-train\n");
+    printf("  -x<0.0-1.0>   Evaluator mix with -w (%.1f)\n", MIX);
+    printf("  -s<seed>      Random seed (time)\n");
+    printf("  -h            Print this help text\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    struct selfplay s = {
+        .size = (size_t)BUFFER_MB << 20,
+        .playouts = PLAYOUTS,
+        .opening = OPENING,
+        .mix = MIX,
+        .seed = os_uepoch(),
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+    };
+    int nthreads = os_cpu_count();
+    size_t shard_mb = SHARD_MB;
+    const char *weights_path = NULL;
+    static float weights[YAVALATH_EVAL_WEIGHTS];
+
+    for (int i = 1; i < argc; i++) {
+        char *p = argv[i] + 1;
+        if (argv[i][0] != '-')
+            goto fail;
+        if (*p != 'h' && !p[1])
+            goto missing;
+        switch (*p) {
+            case 'o':
+                shard.prefix = p + 1;
+                break;
+            case 'g':
+                s.max_games = strtol(p + 1, 0, 10);
+                break;
+            case 'p':
+                s.playouts = strtoul(p + 1, 0, 10);
+                if (!s.playouts)
+                    goto fail;
+                break;
+            case 'r':
+                s.opening = strtol(p + 1, 0, 10);
+                break;
+            case 'j':
+                nthreads = strtol(p + 1, 0, 10);
+                if (nthreads < 1)
+                    nthreads = 1;
+                break;
+            case 'm':
+                s.size = strtoull(p + 1, 0, 10) << 20;
+                break;
+            case 'S':
+                shard_mb = strtoull(p + 1, 0, 10);
+                if (!shard_mb)
+                    goto fail;
+                break;
+            case 'w':
+                weights_path = p + 1;
+                break;
+            case 'x':
+                s.mix = strtof(p + 1, 0);
+                if (!(s.mix >= 0 && s.mix <= 1))
+                    goto fail;
+                break;
+            case 's':
+                s.seed = strtoull(p + 1, 0, 10);
+                break;
+            case 'h':
+                print_usage();
+                exit(0);
+            default:
+                goto fail;
+        }
+        continue;
+  missing:
+        fprintf(stderr, "yavalath-selfplay: missing argument, %s\n", argv[i]);
+        exit(-1);
+  fail:
+        fprintf(stderr, "yavalath-selfplay: bad argument, %s\n", argv[i]);
+        exit(-1);
+    }
+    if (!shard.prefix) {
+        print_usage();
+        exit(-1);
+    }
+    if (weights_path) {
+        if (!weights_load(weights_path, weights, YAVALATH_EVAL_WEIGHTS)) {
+            fprintf(stderr, "yavalath-selfplay: cannot read weights, %s\n",
+                    weights_path);
+            exit(-1);
+        }
+        s.weights = weights;
+    }
+    shard.max_records = ((uint64_t)shard_mb << 20) / RECORD_SIZE;
+
+    out.cap = (size_t)BATCH_MB << 20;
+    out.max_games = out.cap / RECORD_SIZE;
+    for (int i = 0; i < 2; i++) {
+        out.batches[i].data = malloc(out.cap);
+        out.batches[i].games = malloc(sizeof(struct game) * out.max_games);
+        if (!out.batches[i].data || !out.batches[i].games) {
+            fprintf(stderr, "yavalath-selfplay: out of memory\n");
+            exit(-1);
+        }
+    }
+    uint64_t start = out.swapped = os_uepoch();
+    signal(SIGINT, on_interrupt);
+    signal(SIGTERM, on_interrupt);
+
+    pthread_t writer_thread;
+    pthread_create(&writer_thread, NULL, writer, NULL);
+    pthread_t *threads = malloc(sizeof(*threads) * nthreads);
+    for (int i = 0; i < nthreads; i++)
+        pthread_create(threads + i, NULL, worker, &s);
+
+    /* Report progress until the workers run out of games. */
+    for (;;) {
+        pthread_mutex_lock(&s.lock);
+        int done = interrupted ||
+                   (s.max_games && s.games >= (uint64_t)s.max_games);
+        pthread_mutex_unlock(&s.lock);
+        print_status(&s, start);
+        if (done)
+            break;
+        struct timespec second = {1, 0};
+        nanosleep(&second, NULL);
+    }
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    pthread_mutex_lock(&out.lock);
+    out.finished = 1;
+    pthread_cond_signal(&out.ready);
+    pthread_mutex_unlock(&out.lock);
+    pthread_join(writer_thread, NULL);
+    print_status(&s, start);
+    fputc('\n', stderr);
+    return 0;
+}
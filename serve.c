@@ -0,0 +1,551 @@
+/**
+ * Yavalath engine server
+ *
+ * Hosts many simultaneous games behind a line protocol, read from
+ * stdin or from clients of a Unix socket. Memory is one budget shared
+ * by all sessions and handed out in chunks. A session starts with a
+ * single chunk and takes more from the budget whenever its tree fills
+ * up, up to its quota, and gives them back as its tree shrinks after a
+ * move and when its game ends. Since most games never come near their
+ * quota, many more fit than with a fixed buffer each. Every session
+ * has its own address range, a quota in size, in one reservation made
+ * up front, so growing never moves a tree. Searches are run
+ * round-robin in fixed playout slices across a pool of worker threads
+ * so that no session starves the others.
+ *
+ * Protocol (one command per line, replies are single lines):
+ *   new <name> [seed]            -> ok new <name>
+ *   play <name> <move>           -> ok play <name> [win|loss|draw]
+ *                                   (no more moves once decided)
+ *   go <name> [msecs] [playouts] -> bestmove <name> <move> <score> <n>
+ *                                   [quota|memory]
+ *                                   (cut short by the session's quota,
+ *                                   or by the shared budget)
+ *   stop <name>                  (ends a search early)
+ *   end <name>                   -> ok end <name>
+ *   stats                        -> stats <sessions> <free> <quota>
+ *                                   (free budget and quota in bytes)
+ *   quit
+ * Failures are reported as "error <reason>".
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "yavalath.h"
+#include "os.h"
+
+#define POOL_USAGE    0.5f
+#define QUOTA_MB      256
+#define CHUNK         ((size_t)4 << 20)
+#define TIMEOUT_MSEC  (5 * 1000UL)
+#define MAX_PLAYOUTS  UINT32_C(25000000)
+#define SLICE         UINT32_C(4096)
+
+struct client {
+    FILE *in;
+    FILE *out;
+    int replies;                // workers replying outside the lock
+};
+
+struct session {
+    char name[32];
+    struct client *client;
+    void *buf;
+    size_t chunks;              // taken from the budget
+    size_t size;                // size the AI was last told about
+    yavalath_bitboard board[2];
+    int turn;
+    int active;
+    int over;                   // game decided
+    int searching;              // busy with a search or a move
+    volatile int stop;          // checked between playouts
+    int ending;
+    uint64_t deadline;
+    uint32_t playouts;
+    uint32_t max_playouts;
+    struct session *next;       // run queue link
+};
+
+static struct {
+    char *arena;
+    size_t quota;               // in chunks
+    size_t chunks_free;
+    int nslots;
+    int nfree;
+    struct session *sessions;   // one per slot
+} pool;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t replied = PTHREAD_COND_INITIALIZER;
+static struct session *runq_head;
+static struct session *runq_tail;
+static uint64_t seed_base;
+
+/* Send one reply line, never with the global lock held. Workers and
+ * the client's own thread may both write to a client, so the whole
+ * line is written under its stream lock.
+ */
+static void
+reply(struct client *c, const char *fmt, ...)
+{
+    if (!c)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    flockfile(c->out);
+    vfprintf(c->out, fmt, ap);
+    fputc('\n', c->out);
+    fflush(c->out);
+    funlockfile(c->out);
+    va_end(ap);
+}
+
+static struct session *
+session_find(const char *name)
+{
+    for (int i = 0; i < pool.nslots; i++) {
+        struct session *s = pool.sessions + i;
+        if (s->active && !s->ending && !strcmp(s->name, name))
+            return s;
+    }
+    return NULL;
+}
+
+/* Take more chunks from the budget for a full tree, doubling it where
+ * the quota and the budget allow. Returns 0 if none are available.
+ */
+static int
+session_grow(struct session *s)
+{
+    size_t n = s->chunks;
+    if (n > pool.quota - s->chunks)
+        n = pool.quota - s->chunks;
+    if (n > pool.chunks_free)
+        n = pool.chunks_free;
+    pool.chunks_free -= n;
+    s->chunks += n;
+    return n > 0;
+}
+
+static void
+session_release(struct session *s)
+{
+    os_discard(s->buf, s->chunks * CHUNK);
+    pool.chunks_free += s->chunks;
+    s->chunks = 0;
+    s->active = 0;
+    s->ending = 0;
+    s->client = NULL;
+    pool.nfree++;
+}
+
+static void
+runq_push(struct session *s)
+{
+    s->next = NULL;
+    if (runq_tail)
+        runq_tail->next = s;
+    else
+        runq_head = s;
+    runq_tail = s;
+    pthread_cond_signal(&work);
+}
+
+static struct session *
+runq_pop(void)
+{
+    struct session *s = runq_head;
+    runq_head = s->next;
+    if (!runq_head)
+        runq_tail = NULL;
+    return s;
+}
+
+/* The commands below are run with the global lock held, and leave
+ * their reply in msg to be sent once it is released.
+ */
+#define MSG_MAX 128
+
+static void *
+worker(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (!runq_head)
+            pthread_cond_wait(&work, &lock);
+        struct session *s = runq_pop();
+        uint32_t slice = SLICE;
+        if (slice > s->max_playouts - s->playouts)
+            slice = s->max_playouts - s->playouts;
+        size_t size = s->chunks * CHUNK;
+        pthread_mutex_unlock(&lock);
+
+        if (s->size != size) {
+            yavalath_ai_resize(s->buf, size);  // only grows, cannot fail
+            s->size = size;
+        }
+        uint64_t before = yavalath_ai_get_total_playouts(s->buf);
+        enum yavalath_result r =
+            yavalath_ai_search(s->buf, slice, 0, 0, 0, &s->stop);
+        uint64_t done = yavalath_ai_get_total_playouts(s->buf) - before;
+
+        pthread_mutex_lock(&lock);
+        s->playouts += done;
+        int full = r == YAVALATH_BAILOUT_MEMORY;
+        if (full && !s->stop && !s->ending && session_grow(s)) {
+            runq_push(s);
+        } else if (r != YAVALATH_SUCCESS || s->stop || s->ending ||
+                   s->playouts >= s->max_playouts ||
+                   os_uepoch() >= s->deadline) {
+            char msg[MSG_MAX];
+            struct client *c = s->ending ? NULL : s->client;
+            if (c) {
+                char move[YAVALATH_NOTATION_MAX] = "--";
+                double score = 0;
+                if (yavalath_ai_get_total_playouts(s->buf)) {
+                    int bit = yavalath_ai_best_move(s->buf);
+                    yavalath_bit_to_notation(move, bit);
+                    score = yavalath_ai_get_move_score(s->buf, bit);
+                }
+                const char *cut = "";
+                if (full)
+                    cut = s->chunks == pool.quota ? " quota" : " memory";
+                snprintf(msg, MSG_MAX, "bestmove %s %s %.4f %" PRIu64 "%s",
+                         s->name, move, score,
+                         yavalath_ai_get_total_playouts(s->buf), cut);
+                c->replies++;
+            }
+            s->searching = 0;
+            if (s->ending)
+                session_release(s);
+            if (c) {
+                pthread_mutex_unlock(&lock);
+                reply(c, "%s", msg);
+                pthread_mutex_lock(&lock);
+                if (!--c->replies)
+                    pthread_cond_broadcast(&replied);
+            }
+        } else {
+            runq_push(s);
+        }
+    }
+    return NULL;
+}
+
+static void
+cmd_new(char *msg, struct client *c, const char *name, const char *seed)
+{
+    struct session *s = NULL;
+    if (!*name || strlen(name) >= sizeof(pool.sessions[0].name)) {
+        snprintf(msg, MSG_MAX, "error bad-name");
+    } else if (session_find(name)) {
+        snprintf(msg, MSG_MAX, "error exists %s", name);
+    } else if (!pool.nfree || !pool.chunks_free) {
+        snprintf(msg, MSG_MAX, "error no-memory %s", name);
+    } else {
+        for (int i = 0; !s; i++)
+            if (!pool.sessions[i].active)
+                s = pool.sessions + i;
+        pool.nfree--;
+        pool.chunks_free--;
+        s->chunks = 1;
+        s->size = CHUNK;
+        strcpy(s->name, name);
+        s->client = c;
+        s->board[0] = s->board[1] = 0;
+        s->turn = 0;
+        s->active = 1;
+        s->over = 0;
+        s->searching = 0;
+        s->ending = 0;
+        uint64_t sd = *seed ? strtoull(seed, 0, 10) : seed_base++;
+        yavalath_ai_init_zeroed(s->buf, s->size, 0, 0, sd);
+        snprintf(msg, MSG_MAX, "ok new %s", name);
+    }
+}
+
+/* Play a move. The session is marked busy and the lock is dropped
+ * while its tree is advanced and compacted, so that other sessions
+ * keep searching meanwhile. Chunks the smaller tree no longer needs
+ * go back to the budget.
+ */
+static void
+cmd_play(char *msg, struct session *s, const char *move)
+{
+    int bit = yavalath_notation_to_bit(move);
+    yavalath_bitboard taken = s->board[0] | s->board[1];
+    if (s->searching) {
+        snprintf(msg, MSG_MAX, "error busy %s", s->name);
+    } else if (s->over) {
+        snprintf(msg, MSG_MAX, "error game-over %s", s->name);
+    } else if (bit == -1 || (taken >> bit & 1)) {
+        snprintf(msg, MSG_MAX, "error bad-move %s", move);
+    } else {
+        static const char *names[] = {"", " win", " loss", " draw"};
+        s->board[s->turn] |= YAVALATH_BIT(bit);
+        enum yavalath_game_result result =
+            yavalath_check(s->board[s->turn], s->board[!s->turn], bit, 0);
+        s->turn = !s->turn;
+        s->over = result != YAVALATH_GAME_UNRESOLVED;
+        snprintf(msg, MSG_MAX, "ok play %s%s", s->name, names[result]);
+
+        s->searching = 1;
+        pthread_mutex_unlock(&lock);
+        yavalath_ai_advance(s->buf, bit);
+        yavalath_ai_compact(s->buf);
+        size_t keep = s->chunks;
+        while (keep > 1 && yavalath_ai_get_nodes_used(s->buf) <
+                           yavalath_ai_get_nodes_total(s->buf) / 8 &&
+               yavalath_ai_resize(s->buf, (keep + 1) / 2 * CHUNK) ==
+               YAVALATH_SUCCESS)
+            keep = (keep + 1) / 2;
+        os_discard((char *)s->buf + keep * CHUNK,
+                   (s->chunks - keep) * CHUNK);
+        pthread_mutex_lock(&lock);
+        pool.chunks_free += s->chunks - keep;
+        s->chunks = keep;
+        s->size = keep * CHUNK;
+        s->searching = 0;
+        if (s->ending)
+            session_release(s);  // ended while the move was made
+    }
+}
+
+static void
+cmd_go(char *msg, struct session *s, const char *msecs,
+       const char *playouts)
+{
+    if (s->searching) {
+        snprintf(msg, MSG_MAX, "error busy %s", s->name);
+        return;
+    } else if (s->over) {
+        snprintf(msg, MSG_MAX, "error game-over %s", s->name);
+        return;
+    }
+    uint64_t ms = *msecs ? strtoull(msecs, 0, 10) : TIMEOUT_MSEC;
+    s->deadline = os_uepoch() + ms * 1000;
+    s->max_playouts = *playouts ? strtoul(playouts, 0, 10) : MAX_PLAYOUTS;
+    s->playouts = 0;
+    s->stop = 0;
+    s->searching = 1;
+    runq_push(s);
+}
+
+static void
+serve(struct client *c)
+{
+    char line[256];
+    while (fgets(line, sizeof(line), c->in)) {
+        char cmd[16] = "", a[32] = "", b[32] = "", d[32] = "";
+        if (sscanf(line, "%15s %31s %31s %31s", cmd, a, b, d) < 1)
+            continue;
+        if (!strcmp(cmd, "quit"))
+            break;
+
+        char msg[MSG_MAX] = "";
+        pthread_mutex_lock(&lock);
+        struct session *s = session_find(a);
+        if (!strcmp(cmd, "new")) {
+            cmd_new(msg, c, a, b);
+        } else if (!strcmp(cmd, "stats")) {
+            snprintf(msg, MSG_MAX, "stats %d %zu %zu",
+                     pool.nslots - pool.nfree, pool.chunks_free * CHUNK,
+                     pool.quota * CHUNK);
+        } else if (!s) {
+            snprintf(msg, MSG_MAX, "error unknown-session %s", a);
+        } else if (!strcmp(cmd, "play")) {
+            cmd_play(msg, s, b);
+        } else if (!strcmp(cmd, "go")) {
+            cmd_go(msg, s, b, d);
+        } else if (!strcmp(cmd, "stop")) {
+            s->stop = 1;
+        } else if (!strcmp(cmd, "end")) {
+            if (s->searching)
+                s->ending = s->stop = 1;  // worker releases it
+            else
+                session_release(s);
+            snprintf(msg, MSG_MAX, "ok end %s", a);
+        } else {
+            snprintf(msg, MSG_MAX, "error unknown-command %s", cmd);
+        }
+        pthread_mutex_unlock(&lock);
+        if (*msg)
+            reply(c, "%s", msg);
+    }
+
+    /* Reclaim every session left behind by this client. */
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < pool.nslots; i++) {
+        struct session *s = pool.sessions + i;
+        if (s->active && s->client == c) {
+            s->client = NULL;
+            if (s->searching)
+                s->ending = s->stop = 1;
+            else
+                session_release(s);
+        }
+    }
+    while (c->replies)
+        pthread_cond_wait(&replied, &lock);  // keep c alive for them
+    pthread_mutex_unlock(&lock);
+}
+
+static void *
+serve_socket_client(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    struct client c = {
+        .in = fdopen(fd, "r"),
+        .out = fdopen(dup(fd), "w"),
+    };
+    if (c.in && c.out)
+        serve(&c);
+    if (c.in)
+        fclose(c.in);
+    if (c.out)
+        fclose(c.out);
+    return NULL;
+}
+
+static void
+print_usage(void)
+{
+    printf("yavalath-serve [options]\n");
+    printf("  -m<0.0-1.0>   Fraction of physical memory for the pool "
+           "(%0.1f)\n", POOL_USAGE);
+    printf("  -q<MB>        Memory quota per game session (%d)\n",
+           QUOTA_MB);
+    printf("  -s<n>         Maximum number of sessions (one per %zu MB)\n",
+           CHUNK >> 20);
+    printf("  -j<threads>   Number of search worker threads (ncpu)\n");
+    printf("  -u<path>      Listen on a Unix socket instead of stdin\n");
+    printf("  -h            Print this help text\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    float pool_usage = POOL_USAGE;
+    size_t quota_mb = QUOTA_MB;
+    long nslots = 0;
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *socket_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        char *p = argv[i] + 1;
+        if (argv[i][0] != '-')
+            goto fail;
+        if (*p != 'h' && !p[1])
+            goto missing;
+        switch (*p) {
+            case 'm':
+                pool_usage = strtof(p + 1, 0);
+                break;
+            case 'q':
+                quota_mb = strtoul(p + 1, 0, 10);
+                if (quota_mb < CHUNK >> 20)
+                    goto fail;  // a session needs at least one chunk
+                break;
+            case 's':
+                nslots = strtol(p + 1, 0, 10);
+                if (nslots < 1)
+                    goto fail;
+                break;
+            case 'j':
+                nthreads = strtol(p + 1, 0, 10);
+                break;
+            case 'u':
+                socket_path = p + 1;
+                break;
+            case 'h':
+                print_usage();
+                exit(0);
+            default:
+                goto fail;
+        }
+        continue;
+  missing:
+        fprintf(stderr, "yavalath-serve: missing argument, %s\n", argv[i]);
+        exit(-1);
+  fail:
+        fprintf(stderr, "yavalath-serve: bad argument, %s\n", argv[i]);
+        exit(-1);
+    }
+    if (nthreads < 1)
+        nthreads = 1;
+
+    /* Reserve a quota of address space for every session, but only
+     * commit to the shared budget.
+     */
+    pool.quota = (quota_mb << 20) / CHUNK;
+    size_t size = os_physical_memory() * pool_usage;
+    pool.chunks_free = size / CHUNK;
+    if (!pool.chunks_free) {
+        fprintf(stderr, "yavalath-serve: pool smaller than one chunk\n");
+        exit(-1);
+    }
+    if (!nslots)
+        nslots = pool.chunks_free;
+    pool.nslots = nslots;
+    do
+        pool.arena = os_alloc((size_t)pool.nslots * pool.quota * CHUNK,
+                              OS_ALLOC_RESERVE);
+    while (!pool.arena && (pool.nslots /= 2));
+    pool.sessions = calloc(pool.nslots, sizeof(pool.sessions[0]));
+    if (!pool.arena || !pool.sessions) {
+        fprintf(stderr, "yavalath-serve: out of memory\n");
+        exit(-1);
+    }
+    for (int i = 0; i < pool.nslots; i++)
+        pool.sessions[i].buf = pool.arena + (size_t)i * pool.quota * CHUNK;
+    pool.nfree = pool.nslots;
+    seed_base = os_uepoch();
+    fprintf(stderr, "yavalath-serve: %zu MB for up to %d sessions of "
+            "%zu MB, %ld threads\n", pool.chunks_free * CHUNK >> 20,
+            pool.nslots, pool.quota * CHUNK >> 20, nthreads);
+
+    for (long i = 0; i < nthreads; i++) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, worker, NULL);
+        pthread_detach(thread);
+    }
+
+    if (!socket_path) {
+        struct client c = {.in = stdin, .out = stdout};
+        serve(&c);
+        return 0;
+    }
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "yavalath-serve: socket path too long\n");
+        exit(-1);
+    }
+    strcpy(addr.sun_path, socket_path);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (listener == -1 ||
+        bind(listener, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+        listen(listener, 64) == -1) {
+        perror("yavalath-serve");
+        exit(-1);
+    }
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd == -1)
+            continue;
+        pthread_t thread;
+        pthread_create(&thread, NULL, serve_socket_client,
+                       (void *)(intptr_t)fd);
+        pthread_detach(thread);
+    }
+}
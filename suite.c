@@ -0,0 +1,517 @@
+/**
+ * Yavalath search efficiency suite
+ *
+ * Measures how many playouts, and how much time, the AI needs to
+ * settle on one of a position's listed answers. Each position in the
+ * suite file is searched from scratch once per seed, checking
+ * `yavalath_ai_best_move()` at regular intervals. A run is solved at
+ * the first check from which the best move stays among the answers
+ * until the playout count has doubled,
+ * and is unsolved if that never happens within the playout limit.
+ *
+ * Suite files hold one position per line, as the moves from the empty
+ * board and the acceptable answers:
+ *
+ *   trap-01: e5 d4 c5 d5 -> c6 f4
+ *
+ * Blank lines and lines starting with # are ignored. Results are one
+ * JSON object per position, then one for the whole suite, giving
+ * percentiles over all runs. Unsolved runs count as infinitely slow,
+ * so a percentile that falls on one is null.
+ *
+ * With -v the AI is not run. Instead the answers of win-* and defend-*
+ * positions are checked against a search of continuous four-threats,
+ * where every attacking move threatens to complete four in a row and
+ * the defender's only reply is to block it, of at most FOUR_DEPTH
+ * attacking moves. A win-* answer must be exactly the set of moves
+ * that start such a win. A defend-* position must have no such win
+ * for the side to move but one for the opponent, and its answer must
+ * be exactly the moves that leave the opponent none. This is weaker
+ * than solving the position: slower, non-forcing wins are not seen.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "yavalath.h"
+#include "os.h"
+
+#define SEEDS       8
+#define PLAYOUTS    250000
+#define INTERVAL    256
+#define BUFFER_MB   256
+#define SEED        1
+#define MAX_LINE    1024
+#define FOUR_DEPTH  6               // attacking moves in a four-threat win
+
+struct position {
+    char name[64];
+    yavalath_bitboard board[2];     // side to move first
+    yavalath_bitboard answers;
+};
+
+struct run {
+    int solved;
+    uint64_t playouts;
+    uint64_t usecs;
+};
+
+struct suite {
+    struct position *positions;
+    int npositions;
+    int nseeds;
+    uint64_t seed;
+    uint32_t max_playouts;
+    uint32_t interval;
+    size_t size;
+    struct run *runs;               // npositions * nseeds
+    int *done;                      // finished runs of each position
+    int next;                       // next run to hand out
+    int printed;                    // positions already reported
+    pthread_mutex_t lock;
+};
+
+/* Parse "name: moves -> answers". Returns 0 on a malformed line. */
+static int
+parse_line(char *line, struct position *p)
+{
+    char *colon = strchr(line, ':');
+    char *arrow = strstr(line, "->");
+    if (!colon || !arrow || arrow < colon)
+        return 0;
+    *colon = 0;
+    *arrow = 0;
+    char *name = line + strspn(line, " \t");
+    name[strcspn(name, " \t")] = 0;
+    if (!*name || strlen(name) >= sizeof(p->name))
+        return 0;
+    strcpy(p->name, name);
+
+    yavalath_bitboard board[2] = {0, 0};
+    int turn = 0;
+    char *save;
+    for (char *tok = strtok_r(colon + 1, " \t", &save); tok;
+         tok = strtok_r(0, " \t", &save)) {
+        int bit = yavalath_notation_to_bit(tok);
+        if (bit == -1 || (((board[0] | board[1]) >> bit) & 1))
+            return 0;
+        board[turn] |= YAVALATH_BIT(bit);
+        if (yavalath_check(board[turn], board[!turn], bit, 0))
+            return 0;  // game already over
+        turn = !turn;
+    }
+    p->board[0] = board[turn];
+    p->board[1] = board[!turn];
+
+    p->answers = 0;
+    for (char *tok = strtok_r(arrow + 2, " \t\r\n", &save); tok;
+         tok = strtok_r(0, " \t\r\n", &save)) {
+        int bit = yavalath_notation_to_bit(tok);
+        if (bit == -1 || (((board[0] | board[1]) >> bit) & 1))
+            return 0;
+        p->answers |= YAVALATH_BIT(bit);
+    }
+    return !!p->answers;
+}
+
+static void
+run_position(void *buf, size_t size, const struct suite *s,
+             const struct position *p, uint64_t seed, struct run *r)
+{
+    yavalath_ai_init(buf, size, p->board[0], p->board[1], seed);
+    uint64_t start = os_uepoch();
+    uint64_t since = 0;             // playouts when the streak began
+    uint64_t since_usecs = 0;
+    int streak = 0;
+    r->solved = 0;
+    for (;;) {
+        enum yavalath_result result = yavalath_ai_playout(buf, s->interval);
+        uint64_t playouts = yavalath_ai_get_total_playouts(buf);
+        int best = yavalath_ai_best_move(buf);
+        if ((p->answers >> best) & 1) {
+            if (!streak) {
+                since = playouts;
+                since_usecs = os_uepoch() - start;
+            }
+            streak = 1;
+            if (playouts >= since * 2) {
+                r->solved = 1;
+                r->playouts = since;
+                r->usecs = since_usecs;
+                return;
+            }
+        } else {
+            streak = 0;
+        }
+        if (result != YAVALATH_SUCCESS || playouts >= s->max_playouts)
+            return;
+    }
+}
+
+/* Empty cells where a player would complete four in a row. */
+static yavalath_bitboard
+threats(yavalath_bitboard who, yavalath_bitboard opponent)
+{
+    yavalath_bitboard cells = 0;
+    for (int i = 0; i < YAVALATH_CELLS; i++)
+        if (!(((who | opponent) >> i) & 1) &&
+            yavalath_check(who | YAVALATH_BIT(i), opponent, i, 0) ==
+            YAVALATH_GAME_WIN)
+            cells |= YAVALATH_BIT(i);
+    return cells;
+}
+
+static int
+lowest_bit(yavalath_bitboard x)
+{
+    int i = 0;
+    while (!((x >> i) & 1))
+        i++;
+    return i;
+}
+
+static int four_threat_win(yavalath_bitboard, yavalath_bitboard, int);
+
+/* Does playing bit start a four-threat win for who? */
+static int
+four_threat_move(yavalath_bitboard who, yavalath_bitboard opponent,
+                 int bit, int depth)
+{
+    who |= YAVALATH_BIT(bit);
+    switch (yavalath_check(who, opponent, bit, 0)) {
+        case YAVALATH_GAME_WIN:
+            return 1;
+        case YAVALATH_GAME_UNRESOLVED:
+            break;
+        default:
+            return 0;
+    }
+    yavalath_bitboard t = threats(who, opponent);
+    if (!t || threats(opponent, who))
+        return 0;  // no threat, or the opponent wins first
+    if (t & (t - 1))
+        return 1;  // two threats cannot both be blocked
+    int block = lowest_bit(t);
+    opponent |= t;
+    switch (yavalath_check(opponent, who, block, 0)) {
+        case YAVALATH_GAME_LOSS:
+            return 1;  // the forced block makes three in a row
+        case YAVALATH_GAME_UNRESOLVED:
+            break;
+        default:
+            return 0;
+    }
+    return depth > 1 && four_threat_win(who, opponent, depth - 1);
+}
+
+/* Can who, to move, win with at most depth attacking moves? */
+static int
+four_threat_win(yavalath_bitboard who, yavalath_bitboard opponent, int depth)
+{
+    if (threats(who, opponent))
+        return 1;
+    yavalath_bitboard t = threats(opponent, who);
+    if (t)
+        return !(t & (t - 1)) &&
+               four_threat_move(who, opponent, lowest_bit(t), depth);
+    for (int i = 0; i < YAVALATH_CELLS; i++)
+        if (!(((who | opponent) >> i) & 1) &&
+            four_threat_move(who, opponent, i, depth))
+            return 1;
+    return 0;
+}
+
+/* Check the answers of a position against the four-threat search,
+ * returning 1 if they agree, 0 if not, and -1 if its kind is unknown.
+ * The moves the search picks out are stored either way.
+ */
+static int
+verify_position(const struct position *p, yavalath_bitboard *found)
+{
+    yavalath_bitboard me = p->board[0];
+    yavalath_bitboard opponent = p->board[1];
+    yavalath_bitboard wins = 0;
+    for (int i = 0; i < YAVALATH_CELLS; i++)
+        if (!(((me | opponent) >> i) & 1) &&
+            four_threat_move(me, opponent, i, FOUR_DEPTH))
+            wins |= YAVALATH_BIT(i);
+    *found = wins;
+    if (!strncmp(p->name, "win-", 4))
+        return wins && wins == p->answers;
+    if (strncmp(p->name, "defend-", 7))
+        return -1;
+
+    /* Moves after which the opponent has no such win. */
+    yavalath_bitboard saves = 0;
+    for (int i = 0; !wins && i < YAVALATH_CELLS; i++) {
+        if (((me | opponent) >> i) & 1)
+            continue;
+        yavalath_bitboard after = me | YAVALATH_BIT(i);
+        if (yavalath_check(after, opponent, i, 0) != YAVALATH_GAME_LOSS &&
+            !four_threat_win(opponent, after, FOUR_DEPTH))
+            saves |= YAVALATH_BIT(i);
+    }
+    if (!wins)
+        *found = saves;
+    return !wins && four_threat_win(opponent, me, FOUR_DEPTH) &&
+           saves && saves == p->answers;
+}
+
+/* Check every position, returning the number that disagree. */
+static int
+verify(const struct suite *s)
+{
+    int failed = 0;
+    int agreed = 0;
+    for (int i = 0; i < s->npositions; i++) {
+        const struct position *p = s->positions + i;
+        yavalath_bitboard found;
+        int r = verify_position(p, &found);
+        printf("{\"name\":\"%s\",\"four_threat\":[", p->name);
+        const char *sep = "";
+        for (int b = 0; b < YAVALATH_CELLS; b++) {
+            if ((found >> b) & 1) {
+                char move[YAVALATH_NOTATION_MAX];
+                yavalath_bit_to_notation(move, b);
+                printf("%s\"%s\"", sep, move);
+                sep = ",";
+            }
+        }
+        printf("],\"agrees\":%s}\n",
+               r < 0 ? "null" : r ? "true" : "false");
+        fflush(stdout);
+        failed += !r;
+        agreed += r > 0;
+    }
+    printf("{\"name\":\"total\",\"agree\":%d,\"disagree\":%d}\n",
+           agreed, failed);
+    return failed;
+}
+
+static int
+u64_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Print nearest-rank percentiles, with UINT64_MAX for unsolved runs. */
+static void
+print_percentiles(const char *key, uint64_t *values, int n, double scale)
+{
+    static const int pcts[] = {10, 25, 50, 75, 90};
+    qsort(values, n, sizeof(*values), u64_cmp);
+    printf(",\"%s\":{", key);
+    for (int i = 0; i < (int)(sizeof(pcts) / sizeof(*pcts)); i++) {
+        int rank = (pcts[i] * n + 99) / 100;
+        uint64_t v = values[rank ? rank - 1 : 0];
+        printf("%s\"p%d\":", i ? "," : "", pcts[i]);
+        if (v == UINT64_MAX)
+            printf("null");
+        else
+            printf("%.6g", v * scale);
+    }
+    printf("}");
+}
+
+static void
+print_result(const char *name, const struct run *runs, int n)
+{
+    uint64_t *playouts = malloc(sizeof(*playouts) * n);
+    uint64_t *usecs = malloc(sizeof(*usecs) * n);
+    int solved = 0;
+    for (int i = 0; i < n; i++) {
+        solved += runs[i].solved;
+        playouts[i] = runs[i].solved ? runs[i].playouts : UINT64_MAX;
+        usecs[i] = runs[i].solved ? runs[i].usecs : UINT64_MAX;
+    }
+    printf("{\"name\":\"%s\",\"runs\":%d,\"solved\":%d", name, n, solved);
+    print_percentiles("playouts", playouts, n, 1);
+    print_percentiles("msecs", usecs, n, 1e-3);
+    printf("}\n");
+    free(playouts);
+    free(usecs);
+}
+
+static void *
+worker(void *arg)
+{
+    struct suite *s = arg;
+    size_t size = s->size;
+    void *buf = os_alloc(size, 0);
+    if (!buf) {
+        fprintf(stderr, "yavalath-suite: out of memory\n");
+        exit(-1);
+    }
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        int i = s->next++;
+        pthread_mutex_unlock(&s->lock);
+        if (i >= s->npositions * s->nseeds)
+            break;
+        const struct position *p = s->positions + i / s->nseeds;
+        run_position(buf, size, s, p, s->seed + i % s->nseeds, s->runs + i);
+
+        /* Report positions in order as their last runs finish. */
+        pthread_mutex_lock(&s->lock);
+        s->done[i / s->nseeds]++;
+        for (; s->printed < s->npositions &&
+               s->done[s->printed] == s->nseeds; s->printed++)
+            print_result(s->positions[s->printed].name,
+                         s->runs + s->printed * s->nseeds, s->nseeds);
+        fflush(stdout);
+        pthread_mutex_unlock(&s->lock);
+    }
+    os_free(buf, size);
+    return NULL;
+}
+
+static void
+print_usage(void)
+{
+    printf("yavalath-suite [options] <file>\n");
+    printf("  -n<seeds>     Runs per position (%d)\n", SEEDS);
+    printf("  -p<playouts>  Give up on a run after this many (%d)\n",
+           PLAYOUTS);
+    printf("  -i<playouts>  Playouts between checks of the best move "
+           "(%d)\n", INTERVAL);
+    printf("  -j<threads>   Number of worker threads (ncpu)\n");
+    printf("  -m<MB>        AI buffer size per thread in megabytes (%d)\n",
+           BUFFER_MB);
+    printf("  -s<seed>      Seed of the first run of each position (%d)\n",
+           SEED);
+    printf("  -v            Check the answers with a four-threat search "
+           "instead\n                of running the AI\n");
+    printf("  -h            Print this help text\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    struct suite s = {
+        .nseeds = SEEDS,
+        .seed = SEED,
+        .max_playouts = PLAYOUTS,
+        .interval = INTERVAL,
+        .size = (size_t)BUFFER_MB << 20,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+    };
+    int nthreads = os_cpu_count();
+    int check = 0;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        char *p = argv[i] + 1;
+        if (argv[i][0] != '-') {
+            if (path)
+                goto fail;
+            path = argv[i];
+            continue;
+        }
+        if (*p != 'h' && *p != 'v' && !p[1])
+            goto missing;
+        switch (*p) {
+            case 'n':
+                s.nseeds = strtol(p + 1, 0, 10);
+                if (s.nseeds < 1)
+                    goto fail;
+                break;
+            case 'p':
+                s.max_playouts = strtoul(p + 1, 0, 10);
+                break;
+            case 'i':
+                s.interval = strtoul(p + 1, 0, 10);
+                if (!s.interval)
+                    goto fail;
+                break;
+            case 'j':
+                nthreads = strtol(p + 1, 0, 10);
+                if (nthreads < 1)
+                    nthreads = 1;
+                break;
+            case 'm':
+                s.size = strtoull(p + 1, 0, 10) << 20;
+                break;
+            case 's':
+                s.seed = strtoull(p + 1, 0, 10);
+                break;
+            case 'v':
+                check = 1;
+                break;
+            case 'h':
+                print_usage();
+                exit(0);
+            default:
+                goto fail;
+        }
+        continue;
+  missing:
+        fprintf(stderr, "yavalath-suite: missing argument, %s\n", argv[i]);
+        exit(-1);
+  fail:
+        fprintf(stderr, "yavalath-suite: bad argument, %s\n", argv[i]);
+        exit(-1);
+    }
+    if (!path) {
+        print_usage();
+        exit(-1);
+    }
+
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        exit(-1);
+    }
+    int cap = 0;
+    char line[MAX_LINE];
+    for (unsigned long lineno = 1; fgets(line, sizeof(line), in); lineno++) {
+        char *start = line + strspn(line, " \t\r\n");
+        if (!*start || *start == '#')
+            continue;
+        if (s.npositions == cap) {
+            cap = cap ? cap * 2 : 64;
+            s.positions = realloc(s.positions, sizeof(*s.positions) * cap);
+            if (!s.positions) {
+                fprintf(stderr, "yavalath-suite: out of memory\n");
+                exit(-1);
+            }
+        }
+        if (!parse_line(start, s.positions + s.npositions)) {
+            fprintf(stderr, "yavalath-suite: %s:%lu: bad position\n",
+                    path, lineno);
+            exit(-1);
+        }
+        s.npositions++;
+    }
+    fclose(in);
+    if (check) {
+        int failed = verify(&s);
+        free(s.positions);
+        return failed ? 1 : 0;
+    }
+
+    int nruns = s.npositions * s.nseeds;
+    s.runs = calloc(nruns ? nruns : 1, sizeof(*s.runs));
+    s.done = calloc(s.npositions ? s.npositions : 1, sizeof(*s.done));
+    if (!s.runs || !s.done) {
+        fprintf(stderr, "yavalath-suite: out of memory\n");
+        exit(-1);
+    }
+    if (nthreads > nruns)
+        nthreads = nruns ? nruns : 1;
+    pthread_t *threads = malloc(sizeof(*threads) * nthreads);
+    for (int i = 0; i < nthreads; i++)
+        pthread_create(threads + i, NULL, worker, &s);
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    if (nruns)
+        print_result("total", s.runs, nruns);
+    free(s.runs);
+    free(s.done);
+    free(s.positions);
+    return 0;
+}
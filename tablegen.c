@@ -3,9 +3,22 @@
 #include <string.h>
 #include <inttypes.h>
 
-static uint64_t pattern_lose[61][9];
-static uint64_t pattern_win[61][12];
-static int8_t store_map[9][9];
+#define RADIUS_MAX 6
+#define CELLS_MAX  (3 * RADIUS_MAX * (RADIUS_MAX + 1) + 1)
+#define SPAN_MAX   (2 * RADIUS_MAX + 1)
+
+/* Masks are built as two 64-bit words so that tables for boards of up
+ * to 128 cells can be generated without a 128-bit integer type.
+ */
+struct mask {
+    uint64_t w[2];
+};
+
+static struct mask pattern_lose[CELLS_MAX][9];
+static struct mask pattern_win[CELLS_MAX][12];
+static int8_t store_map[SPAN_MAX][SPAN_MAX];
+static int radius;
+static int cells;
 
 static int
 hex_norm(int q, int r)
@@ -13,21 +26,64 @@ hex_norm(int q, int r)
     return (abs(q) + abs(q + r) + abs(r)) / 2;
 }
 
+static int
+mask_empty(struct mask m)
+{
+    return !m.w[0] && !m.w[1];
+}
+
+/* True if the mask has any bit below the given bit. */
+static int
+mask_below(struct mask m, int bit)
+{
+    if (bit < 64)
+        return !!(m.w[0] & ((UINT64_C(1) << bit) - 1));
+    return m.w[0] || (m.w[1] & ((UINT64_C(1) << (bit - 64)) - 1));
+}
+
+static void
+print_mask(struct mask m)
+{
+    if (cells <= 64)
+        printf("0x%016" PRIx64, m.w[0]);
+    else
+        printf("B(0x%016" PRIx64 ", 0x%016" PRIx64 ")", m.w[1], m.w[0]);
+}
+
+static void
+print_row(const struct mask *masks, int n, const char *indent)
+{
+    int per_line = cells <= 64 ? 3 : 2;
+    for (int j = 0; j < n; j++) {
+        printf("%s", j % per_line == 0 ? indent : ", ");
+        print_mask(masks[j]);
+        if (j % per_line == per_line - 1 || j == n - 1)
+            printf(",\n");
+    }
+}
+
 int
-main(void)
+main(int argc, char **argv)
 {
+    radius = argc > 1 ? atoi(argv[1]) : 4;
+    if (radius < 2 || radius > RADIUS_MAX) {
+        fprintf(stderr, "usage: tablegen [radius (2-%d)]\n", RADIUS_MAX);
+        return 1;
+    }
+    int span = 2 * radius + 1;
+    const char *type = radius <= 4 ? "uint64_t" : "unsigned __int128";
+
     /* Map hex tiles to bit storage. */
     memset(store_map, -1, sizeof(store_map));
-    int count = 0;
-    for (int q = -4; q <= 4; q++)
-        for (int r = -4; r <= 4; r++)
-            if (hex_norm(q, r) < 5)
-                store_map[q + 4][r + 4] = count++;
+    for (int q = -radius; q <= radius; q++)
+        for (int r = -radius; r <= radius; r++)
+            if (hex_norm(q, r) <= radius)
+                store_map[q + radius][r + radius] = cells++;
 
     /* Compute bitmasks defining the rules. */
-    for (int q = -4; q <= 4; q++) {
-        for (int r = -4; r <= 4; r++) {
-            int center_bit = store_map[q + 4][r + 4];
+    for (int q = -radius; q <= radius; q++) {
+        for (int r = -radius; r <= radius; r++) {
+            int center_bit = store_map[q + radius][r + radius];
             if (center_bit == -1)
                 continue;
             int hex_axes[] = {1, 0, 0, 1, -1, 1};
@@ -37,15 +93,16 @@ main(void)
                     int dq = hex_axes[d * 2 + 0];
                     int dr = hex_axes[d * 2 + 1];
                     for (int offset = 1 - length; offset <= 0; offset++) {
-                        uint64_t mask = 0;
+                        struct mask mask = {{0, 0}};
                         int bits_set = 0;
                         for (int i = 0; i < length; i++) {
                             int tq = q + dq * (offset + i);
                             int tr = r + dr * (offset + i);
-                            if (tq >= -4 && tq <= 4 && tr >= -4 && tr <= 4) {
-                                int bit = store_map[tq + 4][tr + 4];
+                            if (tq >= -radius && tq <= radius &&
+                                tr >= -radius && tr <= radius) {
+                                int bit = store_map[tq + radius][tr + radius];
                                 if (bit != -1) {
-                                    mask |= UINT64_C(1) << bit;
+                                    mask.w[bit / 64] |= UINT64_C(1) << bit % 64;
                                     bits_set++;
                                 }
                             }
@@ -64,35 +121,59 @@ main(void)
 
     /* Write out bitmask tables. */
     printf("#include <stdint.h>\n\n");
-    printf("static const int8_t store_map[9][9] = {\n");
-    for (unsigned i = 0; i < 9; i++) {
+    printf("#ifndef YAVALATH_RADIUS\n");
+    printf("#  define YAVALATH_RADIUS %d\n", radius);
+    printf("#elif YAVALATH_RADIUS != %d\n", radius);
+    printf("#  error \"tables.h was generated for radius %d\"\n", radius);
+    printf("#endif\n\n");
+    if (cells > 64)
+        printf("#define B(hi, lo) ((unsigned __int128)(hi) << 64 | (lo))\n\n");
+    printf("static const int8_t store_map[%d][%d] = {\n", span, span);
+    for (int i = 0; i < span; i++) {
         printf("    {");
-        for (unsigned j = 0; j < 9; j++)
-            printf("%2d%s", store_map[i][j], j == 8 ? "" : ", ");
+        for (int j = 0; j < span; j++)
+            printf("%2d%s", store_map[i][j], j == span - 1 ? "" : ", ");
         printf("},\n");
     }
     printf("};\n\n");
-    printf("static const uint64_t pattern_lose[61][9] = {\n");
-    for (unsigned i = 0; i < 61; i++) {
+    printf("static const %s pattern_lose[%d][9] = {\n", type, cells);
+    for (int i = 0; i < cells; i++) {
         printf("    {\n");
-        for (unsigned j = 0; j < 9; j++)
-            printf("%s0x%016" PRIx64 "%s",
-                   j % 3 == 0 ? "        " : ", ",
-                   pattern_lose[i][j],
-                   j % 3 == 2 ? ",\n" : "");
+        print_row(pattern_lose[i], 9, "        ");
         printf("    },\n");
     }
     printf("};\n\n");
-    printf("static const uint64_t pattern_win[61][12] = {\n");
-    for (unsigned i = 0; i < 61; i++) {
+    printf("static const %s pattern_win[%d][12] = {\n", type, cells);
+    for (int i = 0; i < cells; i++) {
         printf("    {\n");
-        for (unsigned j = 0; j < 12; j++)
-            printf("%s0x%016" PRIx64 "%s",
-                   j % 3 == 0 ? "        " : ", ",
-                   pattern_win[i][j],
-                   j % 3 == 2 ? ",\n" : "");
+        print_row(pattern_win[i], 12, "        ");
         printf("    },\n");
     }
-    printf("};\n");
+    printf("};\n\n");
+
+    /* Write out each distinct line once, for whole-board scans. */
+    static const char *names[] = {"lines_lose", "lines_win"};
+    static struct mask lines[CELLS_MAX * 12];
+    for (int length = 3; length <= 4; length++) {
+        int count = 0;
+        for (int i = 0; i < cells; i++) {
+            for (int j = 0; j < 12; j++) {
+                struct mask mask = length == 4 ? pattern_win[i][j] :
+                                   j < 9       ? pattern_lose[i][j] :
+                                                 (struct mask){{0, 0}};
+                /* Every mask includes cell i, so emit it only when i
+                 * is its lowest cell. */
+                if (!mask_empty(mask) && !mask_below(mask, i))
+                    lines[count++] = mask;
+            }
+        }
+        printf("static const %s %s[] = {\n", type, names[length - 3]);
+        print_row(lines, count, "    ");
+        printf("};\n");
+        if (length == 3)
+            putchar('\n');
+    }
+    if (cells > 64)
+        printf("\n#undef B\n");
     return 0;
 }
@@ -0,0 +1,779 @@
+#include <stdint.h>
+
+#ifndef YAVALATH_RADIUS
+#  define YAVALATH_RADIUS 4
+#elif YAVALATH_RADIUS != 4
+#  error "tables.h was generated for radius 4"
+#endif
+
+static const int8_t store_map[9][9] = {
+    {-1, -1, -1, -1,  0,  1,  2,  3,  4},
+    {-1, -1, -1,  5,  6,  7,  8,  9, 10},
+    {-1, -1, 11, 12, 13, 14, 15, 16, 17},
+    {-1, 18, 19, 20, 21, 22, 23, 24, 25},
+    {26, 27, 28, 29, 30, 31, 32, 33, 34},
+    {35, 36, 37, 38, 39, 40, 41, 42, -1},
+    {43, 44, 45, 46, 47, 48, 49, -1, -1},
+    {50, 51, 52, 53, 54, 55, -1, -1, -1},
+    {56, 57, 58, 59, 60, -1, -1, -1, -1},
+};
+
+static const uint64_t pattern_lose[61][9] = {
+    {
+        0x0000000000002041, 0x0000000000000007, 0x0000000000000821,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000004082, 0x0000000000000007, 0x000000000000000e,
+        0x0000000000001042, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000008104, 0x0000000000000007, 0x000000000000000e,
+        0x000000000000001c, 0x0000000000002084, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000010208, 0x000000000000000e, 0x000000000000001c,
+        0x0000000000004108, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000020410, 0x000000000000001c, 0x0000000000008210,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000101020, 0x00000000000000e0, 0x0000000000040820,
+        0x0000000000000821, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000002041, 0x0000000000202040, 0x00000000000000e0,
+        0x00000000000001c0, 0x0000000000081040, 0x0000000000001042,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000004082, 0x0000000000404080, 0x00000000000000e0,
+        0x00000000000001c0, 0x0000000000000380, 0x0000000000102080,
+        0x0000000000002084, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000008104, 0x0000000000808100, 0x00000000000001c0,
+        0x0000000000000380, 0x0000000000000700, 0x0000000000204100,
+        0x0000000000004108, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000010208, 0x0000000001010200, 0x0000000000000380,
+        0x0000000000000700, 0x0000000000408200, 0x0000000000008210,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000020410, 0x0000000002020400, 0x0000000000000700,
+        0x0000000000810400, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000010080800, 0x0000000000003800, 0x0000000004040800,
+        0x0000000000040820, 0x0000000000000821, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000101020, 0x0000000020101000, 0x0000000000003800,
+        0x0000000000007000, 0x0000000008081000, 0x0000000000081040,
+        0x0000000000001042, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000002041, 0x0000000000202040, 0x0000000040202000,
+        0x0000000000003800, 0x0000000000007000, 0x000000000000e000,
+        0x0000000010102000, 0x0000000000102080, 0x0000000000002084,
+    },
+    {
+        0x0000000000004082, 0x0000000000404080, 0x0000000080404000,
+        0x0000000000007000, 0x000000000000e000, 0x000000000001c000,
+        0x0000000020204000, 0x0000000000204100, 0x0000000000004108,
+    },
+    {
+        0x0000000000008104, 0x0000000000808100, 0x0000000100808000,
+        0x000000000000e000, 0x000000000001c000, 0x0000000000038000,
+        0x0000000040408000, 0x0000000000408200, 0x0000000000008210,
+    },
+    {
+        0x0000000000010208, 0x0000000001010200, 0x0000000201010000,
+        0x000000000001c000, 0x0000000000038000, 0x0000000080810000,
+        0x0000000000810400, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000020410, 0x0000000002020400, 0x0000000402020000,
+        0x0000000000038000, 0x0000000101020000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000001008040000, 0x00000000001c0000, 0x0000000004040800,
+        0x0000000000040820, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000010080800, 0x0000002010080000, 0x00000000001c0000,
+        0x0000000000380000, 0x0000000808080000, 0x0000000008081000,
+        0x0000000000081040, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000101020, 0x0000000020101000, 0x0000004020100000,
+        0x00000000001c0000, 0x0000000000380000, 0x0000000000700000,
+        0x0000001010100000, 0x0000000010102000, 0x0000000000102080,
+    },
+    {
+        0x0000000000202040, 0x0000000040202000, 0x0000008040200000,
+        0x0000000000380000, 0x0000000000700000, 0x0000000000e00000,
+        0x0000002020200000, 0x0000000020204000, 0x0000000000204100,
+    },
+    {
+        0x0000000000404080, 0x0000000080404000, 0x0000010080400000,
+        0x0000000000700000, 0x0000000000e00000, 0x0000000001c00000,
+        0x0000004040400000, 0x0000000040408000, 0x0000000000408200,
+    },
+    {
+        0x0000000000808100, 0x0000000100808000, 0x0000020100800000,
+        0x0000000000e00000, 0x0000000001c00000, 0x0000000003800000,
+        0x0000008080800000, 0x0000000080810000, 0x0000000000810400,
+    },
+    {
+        0x0000000001010200, 0x0000000201010000, 0x0000040201000000,
+        0x0000000001c00000, 0x0000000003800000, 0x0000010101000000,
+        0x0000000101020000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000002020400, 0x0000000402020000, 0x0000000003800000,
+        0x0000020202000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000080804000000, 0x000000001c000000, 0x0000000004040800,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000001008040000, 0x0000101008000000, 0x000000001c000000,
+        0x0000000038000000, 0x0000000808080000, 0x0000000008081000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000010080800, 0x0000002010080000, 0x0000202010000000,
+        0x000000001c000000, 0x0000000038000000, 0x0000000070000000,
+        0x0000081010000000, 0x0000001010100000, 0x0000000010102000,
+    },
+    {
+        0x0000000020101000, 0x0000004020100000, 0x0000404020000000,
+        0x0000000038000000, 0x0000000070000000, 0x00000000e0000000,
+        0x0000102020000000, 0x0000002020200000, 0x0000000020204000,
+    },
+    {
+        0x0000000040202000, 0x0000008040200000, 0x0000808040000000,
+        0x0000000070000000, 0x00000000e0000000, 0x00000001c0000000,
+        0x0000204040000000, 0x0000004040400000, 0x0000000040408000,
+    },
+    {
+        0x0000000080404000, 0x0000010080400000, 0x0001010080000000,
+        0x00000000e0000000, 0x00000001c0000000, 0x0000000380000000,
+        0x0000408080000000, 0x0000008080800000, 0x0000000080810000,
+    },
+    {
+        0x0000000100808000, 0x0000020100800000, 0x0002020100000000,
+        0x00000001c0000000, 0x0000000380000000, 0x0000000700000000,
+        0x0000810100000000, 0x0000010101000000, 0x0000000101020000,
+    },
+    {
+        0x0000000201010000, 0x0000040201000000, 0x0000000380000000,
+        0x0000000700000000, 0x0001020200000000, 0x0000020202000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000402020000, 0x0000000700000000, 0x0002040400000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000080804000000, 0x0004080800000000, 0x0000003800000000,
+        0x0000000808080000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000001008040000, 0x0000101008000000, 0x0008101000000000,
+        0x0000003800000000, 0x0000007000000000, 0x0000081010000000,
+        0x0000001010100000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000002010080000, 0x0000202010000000, 0x0010202000000000,
+        0x0000003800000000, 0x0000007000000000, 0x000000e000000000,
+        0x0004102000000000, 0x0000102020000000, 0x0000002020200000,
+    },
+    {
+        0x0000004020100000, 0x0000404020000000, 0x0020404000000000,
+        0x0000007000000000, 0x000000e000000000, 0x000001c000000000,
+        0x0008204000000000, 0x0000204040000000, 0x0000004040400000,
+    },
+    {
+        0x0000008040200000, 0x0000808040000000, 0x0040808000000000,
+        0x000000e000000000, 0x000001c000000000, 0x0000038000000000,
+        0x0010408000000000, 0x0000408080000000, 0x0000008080800000,
+    },
+    {
+        0x0000010080400000, 0x0001010080000000, 0x0081010000000000,
+        0x000001c000000000, 0x0000038000000000, 0x0000070000000000,
+        0x0020810000000000, 0x0000810100000000, 0x0000010101000000,
+    },
+    {
+        0x0000020100800000, 0x0002020100000000, 0x0000038000000000,
+        0x0000070000000000, 0x0041020000000000, 0x0001020200000000,
+        0x0000020202000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000040201000000, 0x0000070000000000, 0x0082040000000000,
+        0x0002040400000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000080804000000, 0x0004080800000000, 0x0104080000000000,
+        0x0000380000000000, 0x0000081010000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000101008000000, 0x0008101000000000, 0x0208100000000000,
+        0x0000380000000000, 0x0000700000000000, 0x0004102000000000,
+        0x0000102020000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000202010000000, 0x0010202000000000, 0x0410200000000000,
+        0x0000380000000000, 0x0000700000000000, 0x0000e00000000000,
+        0x0108200000000000, 0x0008204000000000, 0x0000204040000000,
+    },
+    {
+        0x0000404020000000, 0x0020404000000000, 0x0820400000000000,
+        0x0000700000000000, 0x0000e00000000000, 0x0001c00000000000,
+        0x0210400000000000, 0x0010408000000000, 0x0000408080000000,
+    },
+    {
+        0x0000808040000000, 0x0040808000000000, 0x1040800000000000,
+        0x0000e00000000000, 0x0001c00000000000, 0x0003800000000000,
+        0x0420800000000000, 0x0020810000000000, 0x0000810100000000,
+    },
+    {
+        0x0001010080000000, 0x0081010000000000, 0x0001c00000000000,
+        0x0003800000000000, 0x0841000000000000, 0x0041020000000000,
+        0x0001020200000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0002020100000000, 0x0003800000000000, 0x1082000000000000,
+        0x0082040000000000, 0x0002040400000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0004080800000000, 0x0104080000000000, 0x001c000000000000,
+        0x0004102000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0008101000000000, 0x0208100000000000, 0x001c000000000000,
+        0x0038000000000000, 0x0108200000000000, 0x0008204000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0010202000000000, 0x0410200000000000, 0x001c000000000000,
+        0x0038000000000000, 0x0070000000000000, 0x0210400000000000,
+        0x0010408000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0020404000000000, 0x0820400000000000, 0x0038000000000000,
+        0x0070000000000000, 0x00e0000000000000, 0x0420800000000000,
+        0x0020810000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0040808000000000, 0x1040800000000000, 0x0070000000000000,
+        0x00e0000000000000, 0x0841000000000000, 0x0041020000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0081010000000000, 0x00e0000000000000, 0x1082000000000000,
+        0x0082040000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0104080000000000, 0x0700000000000000, 0x0108200000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0208100000000000, 0x0700000000000000, 0x0e00000000000000,
+        0x0210400000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0410200000000000, 0x0700000000000000, 0x0e00000000000000,
+        0x1c00000000000000, 0x0420800000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0820400000000000, 0x0e00000000000000, 0x1c00000000000000,
+        0x0841000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x1040800000000000, 0x1c00000000000000, 0x1082000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+};
+
+static const uint64_t pattern_win[61][12] = {
+    {
+        0x0000000000202041, 0x000000000000000f, 0x0000000000040821,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000404082, 0x000000000000000f, 0x000000000000001e,
+        0x0000000000081042, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000808104, 0x000000000000000f, 0x000000000000001e,
+        0x0000000000102084, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000001010208, 0x000000000000000f, 0x000000000000001e,
+        0x0000000000204108, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000002020410, 0x000000000000001e, 0x0000000000408210,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000020101020, 0x00000000000001e0, 0x0000000004040820,
+        0x0000000000040821, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000202041, 0x0000000040202040, 0x00000000000001e0,
+        0x00000000000003c0, 0x0000000008081040, 0x0000000000081042,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000404082, 0x0000000080404080, 0x00000000000001e0,
+        0x00000000000003c0, 0x0000000000000780, 0x0000000010102080,
+        0x0000000000102084, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000808104, 0x0000000100808100, 0x00000000000001e0,
+        0x00000000000003c0, 0x0000000000000780, 0x0000000020204100,
+        0x0000000000204108, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000001010208, 0x0000000201010200, 0x00000000000003c0,
+        0x0000000000000780, 0x0000000040408200, 0x0000000000408210,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000002020410, 0x0000000402020400, 0x0000000000000780,
+        0x0000000080810400, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000002010080800, 0x0000000000007800, 0x0000000004040820,
+        0x0000000000040821, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000020101020, 0x0000004020101000, 0x0000000000007800,
+        0x000000000000f000, 0x0000000808081000, 0x0000000008081040,
+        0x0000000000081042, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000202041, 0x0000000040202040, 0x0000008040202000,
+        0x0000000000007800, 0x000000000000f000, 0x000000000001e000,
+        0x0000001010102000, 0x0000000010102080, 0x0000000000102084,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000404082, 0x0000000080404080, 0x0000010080404000,
+        0x0000000000007800, 0x000000000000f000, 0x000000000001e000,
+        0x000000000003c000, 0x0000002020204000, 0x0000000020204100,
+        0x0000000000204108, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000808104, 0x0000000100808100, 0x0000020100808000,
+        0x000000000000f000, 0x000000000001e000, 0x000000000003c000,
+        0x0000004040408000, 0x0000000040408200, 0x0000000000408210,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000001010208, 0x0000000201010200, 0x0000040201010000,
+        0x000000000001e000, 0x000000000003c000, 0x0000008080810000,
+        0x0000000080810400, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000002020410, 0x0000000402020400, 0x000000000003c000,
+        0x0000010101020000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000101008040000, 0x00000000003c0000, 0x0000000004040820,
+        0x0000000000040821, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000002010080800, 0x0000202010080000, 0x00000000003c0000,
+        0x0000000000780000, 0x0000000808081000, 0x0000000008081040,
+        0x0000000000081042, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000020101020, 0x0000004020101000, 0x0000404020100000,
+        0x00000000003c0000, 0x0000000000780000, 0x0000000000f00000,
+        0x0000081010100000, 0x0000001010102000, 0x0000000010102080,
+        0x0000000000102084, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000000202041, 0x0000000040202040, 0x0000008040202000,
+        0x0000808040200000, 0x00000000003c0000, 0x0000000000780000,
+        0x0000000000f00000, 0x0000000001e00000, 0x0000102020200000,
+        0x0000002020204000, 0x0000000020204100, 0x0000000000204108,
+    },
+    {
+        0x0000000000404082, 0x0000000080404080, 0x0000010080404000,
+        0x0001010080400000, 0x0000000000780000, 0x0000000000f00000,
+        0x0000000001e00000, 0x0000000003c00000, 0x0000204040400000,
+        0x0000004040408000, 0x0000000040408200, 0x0000000000408210,
+    },
+    {
+        0x0000000000808104, 0x0000000100808100, 0x0000020100808000,
+        0x0002020100800000, 0x0000000000f00000, 0x0000000001e00000,
+        0x0000000003c00000, 0x0000408080800000, 0x0000008080810000,
+        0x0000000080810400, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000001010208, 0x0000000201010200, 0x0000040201010000,
+        0x0000000001e00000, 0x0000000003c00000, 0x0000810101000000,
+        0x0000010101020000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000002020410, 0x0000000402020400, 0x0000000003c00000,
+        0x0001020202000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0004080804000000, 0x000000003c000000, 0x0000000004040820,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000101008040000, 0x0008101008000000, 0x000000003c000000,
+        0x0000000078000000, 0x0000000808081000, 0x0000000008081040,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000002010080800, 0x0000202010080000, 0x0010202010000000,
+        0x000000003c000000, 0x0000000078000000, 0x00000000f0000000,
+        0x0000081010100000, 0x0000001010102000, 0x0000000010102080,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000020101020, 0x0000004020101000, 0x0000404020100000,
+        0x0020404020000000, 0x000000003c000000, 0x0000000078000000,
+        0x00000000f0000000, 0x00000001e0000000, 0x0004102020000000,
+        0x0000102020200000, 0x0000002020204000, 0x0000000020204100,
+    },
+    {
+        0x0000000040202040, 0x0000008040202000, 0x0000808040200000,
+        0x0040808040000000, 0x0000000078000000, 0x00000000f0000000,
+        0x00000001e0000000, 0x00000003c0000000, 0x0008204040000000,
+        0x0000204040400000, 0x0000004040408000, 0x0000000040408200,
+    },
+    {
+        0x0000000080404080, 0x0000010080404000, 0x0001010080400000,
+        0x0081010080000000, 0x00000000f0000000, 0x00000001e0000000,
+        0x00000003c0000000, 0x0000000780000000, 0x0010408080000000,
+        0x0000408080800000, 0x0000008080810000, 0x0000000080810400,
+    },
+    {
+        0x0000000100808100, 0x0000020100808000, 0x0002020100800000,
+        0x00000001e0000000, 0x00000003c0000000, 0x0000000780000000,
+        0x0020810100000000, 0x0000810101000000, 0x0000010101020000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000201010200, 0x0000040201010000, 0x00000003c0000000,
+        0x0000000780000000, 0x0041020200000000, 0x0001020202000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000000402020400, 0x0000000780000000, 0x0082040400000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0004080804000000, 0x0104080800000000, 0x0000007800000000,
+        0x0000000808081000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000101008040000, 0x0008101008000000, 0x0208101000000000,
+        0x0000007800000000, 0x000000f000000000, 0x0000081010100000,
+        0x0000001010102000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000002010080800, 0x0000202010080000, 0x0010202010000000,
+        0x0410202000000000, 0x0000007800000000, 0x000000f000000000,
+        0x000001e000000000, 0x0004102020000000, 0x0000102020200000,
+        0x0000002020204000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000004020101000, 0x0000404020100000, 0x0020404020000000,
+        0x0820404000000000, 0x0000007800000000, 0x000000f000000000,
+        0x000001e000000000, 0x000003c000000000, 0x0108204000000000,
+        0x0008204040000000, 0x0000204040400000, 0x0000004040408000,
+    },
+    {
+        0x0000008040202000, 0x0000808040200000, 0x0040808040000000,
+        0x1040808000000000, 0x000000f000000000, 0x000001e000000000,
+        0x000003c000000000, 0x0000078000000000, 0x0210408000000000,
+        0x0010408080000000, 0x0000408080800000, 0x0000008080810000,
+    },
+    {
+        0x0000010080404000, 0x0001010080400000, 0x0081010080000000,
+        0x000001e000000000, 0x000003c000000000, 0x0000078000000000,
+        0x0420810000000000, 0x0020810100000000, 0x0000810101000000,
+        0x0000010101020000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000020100808000, 0x0002020100800000, 0x000003c000000000,
+        0x0000078000000000, 0x0841020000000000, 0x0041020200000000,
+        0x0001020202000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000040201010000, 0x0000078000000000, 0x1082040000000000,
+        0x0082040400000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0004080804000000, 0x0104080800000000, 0x0000780000000000,
+        0x0000081010100000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000101008040000, 0x0008101008000000, 0x0208101000000000,
+        0x0000780000000000, 0x0000f00000000000, 0x0004102020000000,
+        0x0000102020200000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000202010080000, 0x0010202010000000, 0x0410202000000000,
+        0x0000780000000000, 0x0000f00000000000, 0x0001e00000000000,
+        0x0108204000000000, 0x0008204040000000, 0x0000204040400000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000404020100000, 0x0020404020000000, 0x0820404000000000,
+        0x0000780000000000, 0x0000f00000000000, 0x0001e00000000000,
+        0x0003c00000000000, 0x0210408000000000, 0x0010408080000000,
+        0x0000408080800000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0000808040200000, 0x0040808040000000, 0x1040808000000000,
+        0x0000f00000000000, 0x0001e00000000000, 0x0003c00000000000,
+        0x0420810000000000, 0x0020810100000000, 0x0000810101000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0001010080400000, 0x0081010080000000, 0x0001e00000000000,
+        0x0003c00000000000, 0x0841020000000000, 0x0041020200000000,
+        0x0001020202000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0002020100800000, 0x0003c00000000000, 0x1082040000000000,
+        0x0082040400000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0004080804000000, 0x0104080800000000, 0x003c000000000000,
+        0x0004102020000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0008101008000000, 0x0208101000000000, 0x003c000000000000,
+        0x0078000000000000, 0x0108204000000000, 0x0008204040000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0010202010000000, 0x0410202000000000, 0x003c000000000000,
+        0x0078000000000000, 0x00f0000000000000, 0x0210408000000000,
+        0x0010408080000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0020404020000000, 0x0820404000000000, 0x003c000000000000,
+        0x0078000000000000, 0x00f0000000000000, 0x0420810000000000,
+        0x0020810100000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0040808040000000, 0x1040808000000000, 0x0078000000000000,
+        0x00f0000000000000, 0x0841020000000000, 0x0041020200000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0081010080000000, 0x00f0000000000000, 0x1082040000000000,
+        0x0082040400000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0104080800000000, 0x0f00000000000000, 0x0108204000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0208101000000000, 0x0f00000000000000, 0x1e00000000000000,
+        0x0210408000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0410202000000000, 0x0f00000000000000, 0x1e00000000000000,
+        0x0420810000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x0820404000000000, 0x0f00000000000000, 0x1e00000000000000,
+        0x0841020000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+    {
+        0x1040808000000000, 0x1e00000000000000, 0x1082040000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+        0x0000000000000000, 0x0000000000000000, 0x0000000000000000,
+    },
+};
+
+static const uint64_t lines_lose[] = {
+    0x0000000000002041, 0x0000000000000007, 0x0000000000000821,
+    0x0000000000004082, 0x000000000000000e, 0x0000000000001042,
+    0x0000000000008104, 0x000000000000001c, 0x0000000000002084,
+    0x0000000000010208, 0x0000000000004108, 0x0000000000020410,
+    0x0000000000008210, 0x0000000000101020, 0x00000000000000e0,
+    0x0000000000040820, 0x0000000000202040, 0x00000000000001c0,
+    0x0000000000081040, 0x0000000000404080, 0x0000000000000380,
+    0x0000000000102080, 0x0000000000808100, 0x0000000000000700,
+    0x0000000000204100, 0x0000000001010200, 0x0000000000408200,
+    0x0000000002020400, 0x0000000000810400, 0x0000000010080800,
+    0x0000000000003800, 0x0000000004040800, 0x0000000020101000,
+    0x0000000000007000, 0x0000000008081000, 0x0000000040202000,
+    0x000000000000e000, 0x0000000010102000, 0x0000000080404000,
+    0x000000000001c000, 0x0000000020204000, 0x0000000100808000,
+    0x0000000000038000, 0x0000000040408000, 0x0000000201010000,
+    0x0000000080810000, 0x0000000402020000, 0x0000000101020000,
+    0x0000001008040000, 0x00000000001c0000, 0x0000002010080000,
+    0x0000000000380000, 0x0000000808080000, 0x0000004020100000,
+    0x0000000000700000, 0x0000001010100000, 0x0000008040200000,
+    0x0000000000e00000, 0x0000002020200000, 0x0000010080400000,
+    0x0000000001c00000, 0x0000004040400000, 0x0000020100800000,
+    0x0000000003800000, 0x0000008080800000, 0x0000040201000000,
+    0x0000010101000000, 0x0000020202000000, 0x0000080804000000,
+    0x000000001c000000, 0x0000101008000000, 0x0000000038000000,
+    0x0000202010000000, 0x0000000070000000, 0x0000081010000000,
+    0x0000404020000000, 0x00000000e0000000, 0x0000102020000000,
+    0x0000808040000000, 0x00000001c0000000, 0x0000204040000000,
+    0x0001010080000000, 0x0000000380000000, 0x0000408080000000,
+    0x0002020100000000, 0x0000000700000000, 0x0000810100000000,
+    0x0001020200000000, 0x0002040400000000, 0x0004080800000000,
+    0x0000003800000000, 0x0008101000000000, 0x0000007000000000,
+    0x0010202000000000, 0x000000e000000000, 0x0004102000000000,
+    0x0020404000000000, 0x000001c000000000, 0x0008204000000000,
+    0x0040808000000000, 0x0000038000000000, 0x0010408000000000,
+    0x0081010000000000, 0x0000070000000000, 0x0020810000000000,
+    0x0041020000000000, 0x0082040000000000, 0x0104080000000000,
+    0x0000380000000000, 0x0208100000000000, 0x0000700000000000,
+    0x0410200000000000, 0x0000e00000000000, 0x0108200000000000,
+    0x0820400000000000, 0x0001c00000000000, 0x0210400000000000,
+    0x1040800000000000, 0x0003800000000000, 0x0420800000000000,
+    0x0841000000000000, 0x1082000000000000, 0x001c000000000000,
+    0x0038000000000000, 0x0070000000000000, 0x00e0000000000000,
+    0x0700000000000000, 0x0e00000000000000, 0x1c00000000000000,
+};
+
+static const uint64_t lines_win[] = {
+    0x0000000000202041, 0x000000000000000f, 0x0000000000040821,
+    0x0000000000404082, 0x000000000000001e, 0x0000000000081042,
+    0x0000000000808104, 0x0000000000102084, 0x0000000001010208,
+    0x0000000000204108, 0x0000000002020410, 0x0000000000408210,
+    0x0000000020101020, 0x00000000000001e0, 0x0000000004040820,
+    0x0000000040202040, 0x00000000000003c0, 0x0000000008081040,
+    0x0000000080404080, 0x0000000000000780, 0x0000000010102080,
+    0x0000000100808100, 0x0000000020204100, 0x0000000201010200,
+    0x0000000040408200, 0x0000000402020400, 0x0000000080810400,
+    0x0000002010080800, 0x0000000000007800, 0x0000004020101000,
+    0x000000000000f000, 0x0000000808081000, 0x0000008040202000,
+    0x000000000001e000, 0x0000001010102000, 0x0000010080404000,
+    0x000000000003c000, 0x0000002020204000, 0x0000020100808000,
+    0x0000004040408000, 0x0000040201010000, 0x0000008080810000,
+    0x0000010101020000, 0x0000101008040000, 0x00000000003c0000,
+    0x0000202010080000, 0x0000000000780000, 0x0000404020100000,
+    0x0000000000f00000, 0x0000081010100000, 0x0000808040200000,
+    0x0000000001e00000, 0x0000102020200000, 0x0001010080400000,
+    0x0000000003c00000, 0x0000204040400000, 0x0002020100800000,
+    0x0000408080800000, 0x0000810101000000, 0x0001020202000000,
+    0x0004080804000000, 0x000000003c000000, 0x0008101008000000,
+    0x0000000078000000, 0x0010202010000000, 0x00000000f0000000,
+    0x0020404020000000, 0x00000001e0000000, 0x0004102020000000,
+    0x0040808040000000, 0x00000003c0000000, 0x0008204040000000,
+    0x0081010080000000, 0x0000000780000000, 0x0010408080000000,
+    0x0020810100000000, 0x0041020200000000, 0x0082040400000000,
+    0x0104080800000000, 0x0000007800000000, 0x0208101000000000,
+    0x000000f000000000, 0x0410202000000000, 0x000001e000000000,
+    0x0820404000000000, 0x000003c000000000, 0x0108204000000000,
+    0x1040808000000000, 0x0000078000000000, 0x0210408000000000,
+    0x0420810000000000, 0x0841020000000000, 0x1082040000000000,
+    0x0000780000000000, 0x0000f00000000000, 0x0001e00000000000,
+    0x0003c00000000000, 0x003c000000000000, 0x0078000000000000,
+    0x00f0000000000000, 0x0f00000000000000, 0x1e00000000000000,
+};
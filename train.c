@@ -0,0 +1,286 @@
+/**
+ * Yavalath evaluator trainer
+ *
+ * Plays games against itself, records every position along with the
+ * game's final result, and fits the leaf evaluator's weights to
+ * predict that result by stochastic gradient descent. The weights are
+ * written in the format read by `yavalath-cli -w`, and may be fed
+ * back in with -w to generate the next round of games with the
+ * evaluator's help.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+#include "yavalath.h"
+#include "weights.h"
+#include "os.h"
+
+#define GAMES       200
+#define PLAYOUTS    2000
+#define OPENING     2
+#define EPOCHS      20
+#define RATE        0.01
+#define MIX         0.5
+#define BUFFER_MB   256
+
+#define NWEIGHTS    YAVALATH_EVAL_WEIGHTS
+
+/* Recorded positions, features stored as small counts. */
+static struct {
+    size_t len;
+    size_t cap;
+    uint16_t (*features)[NWEIGHTS];
+    float *target;              // final reward to the player to move
+    uint8_t *turn;              // player to move
+} data;
+
+static uint64_t
+xorshift64(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static void
+record(yavalath_bitboard who, yavalath_bitboard opponent, int turn)
+{
+    if (data.len == data.cap) {
+        data.cap = data.cap ? data.cap * 2 : 4096;
+        data.features = realloc(data.features,
+                                data.cap * sizeof(*data.features));
+        data.target = realloc(data.target, data.cap * sizeof(*data.target));
+        data.turn = realloc(data.turn, data.cap * sizeof(*data.turn));
+        if (!data.features || !data.target || !data.turn) {
+            fprintf(stderr, "yavalath-train: out of memory\n");
+            exit(-1);
+        }
+    }
+    float f[NWEIGHTS];
+    yavalath_eval_features(who, opponent, f);
+    for (int i = 0; i < NWEIGHTS; i++)
+        data.features[data.len][i] = f[i];
+    data.turn[data.len] = turn;
+    data.len++;
+}
+
+static int
+random_move(yavalath_bitboard taken, uint64_t *rng)
+{
+    int options[YAVALATH_CELLS];
+    int noptions = 0;
+    for (int i = 0; i < YAVALATH_CELLS; i++)
+        if (!((taken >> i) & 1))
+            options[noptions++] = i;
+    return options[xorshift64(rng) % noptions];
+}
+
+/* Play one game, recording each position and labeling it with the
+ * result once the game ends.
+ */
+static void
+self_play(void *buf, size_t size, uint32_t playouts, int opening,
+          const float *weights, float mix, uint64_t *rng)
+{
+    yavalath_bitboard board[2] = {0, 0};
+    int turn = 0;
+    size_t first = data.len;
+    enum yavalath_game_result result;
+    yavalath_ai_init(buf, size, 0, 0, xorshift64(rng));
+    if (weights)
+        yavalath_ai_set_evaluator(buf, weights, mix);
+    for (int ply = 0;; ply++) {
+        record(board[turn], board[!turn], turn);
+        int bit;
+        if (ply < opening || !playouts) {
+            bit = random_move(board[0] | board[1], rng);
+        } else {
+            yavalath_ai_playout(buf, playouts);
+            if (yavalath_ai_get_total_playouts(buf))
+                bit = yavalath_ai_best_move(buf);
+            else
+                bit = random_move(board[0] | board[1], rng);
+        }
+        yavalath_ai_advance(buf, bit);
+        board[turn] |= YAVALATH_BIT(bit);
+        result = yavalath_check(board[turn], board[!turn], bit, 0);
+        if (result != YAVALATH_GAME_UNRESOLVED)
+            break;
+        turn = !turn;
+    }
+
+    /* Convert to a reward for each recorded player to move. */
+    int winner = result == YAVALATH_GAME_WIN  ? turn :
+                 result == YAVALATH_GAME_LOSS ? !turn : -1;
+    for (size_t i = first; i < data.len; i++)
+        data.target[i] = winner == -1 ? -0.1f :
+                         winner == data.turn[i] ? 1.0f : -1.0f;
+}
+
+/* One pass of SGD over the data in random order, with each step
+ * normalized by the squared length of the features, since pattern
+ * counts vary widely. Returns the MSE.
+ */
+static double
+train_epoch(float *w, double rate, size_t *order, uint64_t *rng)
+{
+    for (size_t i = data.len - 1; i > 0; i--) {
+        size_t j = xorshift64(rng) % (i + 1);
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    double loss = 0;
+    for (size_t k = 0; k < data.len; k++) {
+        const uint16_t *x = data.features[order[k]];
+        double dot = 0;
+        double norm = 0;
+        for (int i = 0; i < NWEIGHTS; i++) {
+            dot += w[i] * x[i];
+            norm += x[i] * x[i];
+        }
+        double v = tanh(dot);
+        double err = v - data.target[order[k]];
+        loss += err * err;
+        double g = rate * err * (1 - v * v) / norm;
+        for (int i = 0; i < NWEIGHTS; i++)
+            w[i] -= g * x[i];
+    }
+    return loss / data.len;
+}
+
+static void
+print_usage(void)
+{
+    printf("yavalath-train -o<file> [options]\n");
+    printf("  -o<file>      Write trained weights to file\n");
+    printf("  -g<games>     Number of self-play games (%d)\n", GAMES);
+    printf("  -p<playouts>  Playouts per move, 0 for random play (%d)\n",
+           PLAYOUTS);
+    printf("  -r<moves>     Random opening moves per game (%d)\n", OPENING);
+    printf("  -w<file>      Start from these weights, and use them in "
+           "self-play\n");
+    printf("  -x<0.0-1.0>   Evaluator mix during self-play with -w (%.1f)\n",
+           MIX);
+    printf("  -e<epochs>    Passes over the recorded positions (%d)\n",
+           EPOCHS);
+    printf("  -l<rate>      Learning rate (%g)\n", RATE);
+    printf("  -m<MB>        AI buffer size in megabytes (%d)\n", BUFFER_MB);
+    printf("  -s<seed>      Random seed (time)\n");
+    printf("  -h            Print this help text\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *out_path = NULL;
+    const char *in_path = NULL;
+    long games = GAMES;
+    uint32_t playouts = PLAYOUTS;
+    int opening = OPENING;
+    float mix = MIX;
+    int epochs = EPOCHS;
+    double rate = RATE;
+    size_t size = (size_t)BUFFER_MB << 20;
+    uint64_t rng = os_uepoch();
+
+    for (int i = 1; i < argc; i++) {
+        char *p = argv[i] + 1;
+        if (argv[i][0] != '-')
+            goto fail;
+        if (*p != 'h' && !p[1])
+            goto missing;
+        switch (*p) {
+            case 'o':
+                out_path = p + 1;
+                break;
+            case 'g':
+                games = strtol(p + 1, 0, 10);
+                break;
+            case 'p':
+                playouts = strtoul(p + 1, 0, 10);
+                break;
+            case 'r':
+                opening = strtol(p + 1, 0, 10);
+                break;
+            case 'w':
+                in_path = p + 1;
+                break;
+            case 'x':
+                mix = strtof(p + 1, 0);
+                break;
+            case 'e':
+                epochs = strtol(p + 1, 0, 10);
+                break;
+            case 'l':
+                rate = strtod(p + 1, 0);
+                break;
+            case 'm':
+                size = strtoull(p + 1, 0, 10) << 20;
+                break;
+            case 's':
+                rng = strtoull(p + 1, 0, 10);
+                break;
+            case 'h':
+                print_usage();
+                exit(0);
+            default:
+                goto fail;
+        }
+        continue;
+  missing:
+        fprintf(stderr, "yavalath-train: missing argument, %s\n", argv[i]);
+        exit(-1);
+  fail:
+        fprintf(stderr, "yavalath-train: bad argument, %s\n", argv[i]);
+        exit(-1);
+    }
+    if (!out_path) {
+        print_usage();
+        exit(-1);
+    }
+    rng = rng ? rng : 1;  // xorshift state must be non-zero
+
+    float w[NWEIGHTS] = {0};
+    if (in_path && !weights_load(in_path, w, NWEIGHTS)) {
+        fprintf(stderr, "yavalath-train: cannot read weights, %s\n",
+                in_path);
+        exit(-1);
+    }
+
+    void *buf = os_alloc(size, 0);
+    if (!buf) {
+        fprintf(stderr, "yavalath-train: out of memory\n");
+        exit(-1);
+    }
+    for (long g = 0; g < games; g++) {
+        self_play(buf, size, playouts, opening, in_path ? w : 0, mix, &rng);
+        if ((g + 1) % 10 == 0 || g + 1 == games)
+            fprintf(stderr, "\rgame %ld/%ld, %zu positions", g + 1, games,
+                    data.len);
+    }
+    fputc('\n', stderr);
+    os_free(buf, size);
+    if (!data.len)
+        exit(-1);
+
+    size_t *order = malloc(data.len * sizeof(*order));
+    if (!order) {
+        fprintf(stderr, "yavalath-train: out of memory\n");
+        exit(-1);
+    }
+    for (size_t i = 0; i < data.len; i++)
+        order[i] = i;
+    for (int e = 0; e < epochs; e++)
+        fprintf(stderr, "epoch %d, mse %.5f\n", e + 1,
+                train_epoch(w, rate, order, &rng));
+
+    if (!weights_save(out_path, w, NWEIGHTS)) {
+        fprintf(stderr, "yavalath-train: cannot write %s\n", out_path);
+        exit(-1);
+    }
+    return 0;
+}
@@ -0,0 +1,213 @@
+/**
+ * Yavalath search tree reader
+ *
+ * Prints a tree written by `yavalath_ai_dump()` (for example with the
+ * engine protocol's "dump" command) as indented text, one node per
+ * line followed by its moves, best supported first:
+ *
+ *   #0 o to move, 250000 playouts
+ *     e5     61234  +0.0412  #17
+ *     #17 after e5, x to move, 61234 playouts
+ *       d4   ...
+ *
+ * A node is printed only below a printed move, so the cutoffs prune
+ * whole subtrees.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "yavalath.h"
+
+#define WORDS ((YAVALATH_CELLS + 63) / 64)
+
+struct edge {
+    int move;
+    int kind;
+    uint64_t playouts;
+    double reward;
+    uint64_t child;
+};
+
+/* The printed moves of the most recent node at each depth. */
+static struct level {
+    int nshown;
+    struct edge edges[YAVALATH_CELLS];
+} levels[YAVALATH_CELLS + 1];
+
+static int
+get64(FILE *f, uint64_t *x)
+{
+    unsigned char b[8];
+    if (fread(b, sizeof(b), 1, f) != 1)
+        return 0;
+    *x = 0;
+    for (int i = 7; i >= 0; i--)
+        *x = *x << 8 | b[i];
+    return 1;
+}
+
+static int
+edge_cmp(const void *a, const void *b)
+{
+    const struct edge *ea = a;
+    const struct edge *eb = b;
+    if (ea->playouts != eb->playouts)
+        return ea->playouts < eb->playouts ? 1 : -1;
+    return ea->move - eb->move;
+}
+
+static void
+print_usage(void)
+{
+    printf("yavalath-tree [options] <file>\n");
+    printf("  -d<depth>     Deepest node to print (all)\n");
+    printf("  -n<playouts>  Hide moves with fewer playouts (1)\n");
+    printf("  -e<moves>     Print at most this many moves per node (all)\n");
+    printf("  -h            Print this help text\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    int max_depth = YAVALATH_CELLS;
+    uint64_t min_playouts = 1;
+    int max_edges = YAVALATH_CELLS;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        char *p = argv[i] + 1;
+        if (argv[i][0] != '-') {
+            if (path)
+                goto fail;
+            path = argv[i];
+            continue;
+        }
+        if (*p != 'h' && !p[1])
+            goto missing;
+        switch (*p) {
+            case 'd':
+                max_depth = strtol(p + 1, 0, 10);
+                break;
+            case 'n':
+                min_playouts = strtoull(p + 1, 0, 10);
+                break;
+            case 'e':
+                max_edges = strtol(p + 1, 0, 10);
+                break;
+            case 'h':
+                print_usage();
+                exit(0);
+            default:
+                goto fail;
+        }
+        continue;
+  missing:
+        fprintf(stderr, "yavalath-tree: missing argument, %s\n", argv[i]);
+        exit(-1);
+  fail:
+        fprintf(stderr, "yavalath-tree: bad argument, %s\n", argv[i]);
+        exit(-1);
+    }
+    if (!path) {
+        print_usage();
+        exit(-1);
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        exit(-1);
+    }
+    unsigned char header[8];
+    if (fread(header, sizeof(header), 1, f) != 1 ||
+        memcmp(header, "YAVT", 4) || header[4] != 1) {
+        fprintf(stderr, "yavalath-tree: %s is not a tree dump\n", path);
+        exit(-1);
+    }
+    if (header[5] != YAVALATH_CELLS) {
+        fprintf(stderr, "yavalath-tree: dump is for a %d-cell board, "
+                "this build is for %d\n", header[5], YAVALATH_CELLS);
+        exit(-1);
+    }
+
+    unsigned long nodes = 0;
+    unsigned char rec[4];
+    while (fread(rec, sizeof(rec), 1, f) == 1) {
+        int depth = rec[0];
+        int turn = rec[1];
+        int nedges = rec[2];
+        if (depth > YAVALATH_CELLS || turn > 1 || nedges > YAVALATH_CELLS) {
+            fprintf(stderr, "yavalath-tree: corrupt record\n");
+            exit(-1);
+        }
+        uint64_t id, playouts, words[WORDS * 2];
+        int ok = get64(f, &id) && get64(f, &playouts);
+        for (int i = 0; ok && i < WORDS * 2; i++)
+            ok = get64(f, words + i);
+        struct edge *edges = levels[depth].edges;
+        for (int i = 0; ok && i < nedges; i++) {
+            unsigned char mk[2];
+            uint64_t bits = 0;
+            ok = fread(mk, sizeof(mk), 1, f) == 1 &&
+                 get64(f, &edges[i].playouts) &&
+                 get64(f, &bits) &&
+                 get64(f, &edges[i].child);
+            edges[i].move = mk[0];
+            edges[i].kind = mk[1];
+            memcpy(&edges[i].reward, &bits, sizeof(bits));
+            if (ok && mk[0] >= YAVALATH_CELLS) {
+                fprintf(stderr, "yavalath-tree: corrupt record\n");
+                exit(-1);
+            }
+        }
+        if (!ok) {
+            fprintf(stderr, "yavalath-tree: truncated record\n");
+            exit(-1);
+        }
+        nodes++;
+        levels[depth].nshown = 0;
+        if (depth > max_depth)
+            continue;
+
+        /* Find the printed move that leads here, if any. */
+        char move[YAVALATH_NOTATION_MAX] = "";
+        if (depth > 0) {
+            struct level *up = levels + depth - 1;
+            for (int i = 0; i < up->nshown && !move[0]; i++)
+                if (up->edges[i].kind == 0 && up->edges[i].child == id)
+                    yavalath_bit_to_notation(move, up->edges[i].move);
+            if (!move[0])
+                continue;
+        }
+
+        printf("%*s#%" PRIu64 "%s%s%s %c to move, %" PRIu64 " playouts\n",
+               depth * 2, "", id, depth ? " after " : "", move,
+               depth ? "," : "", "ox"[turn], playouts);
+        qsort(edges, nedges, sizeof(*edges), edge_cmp);
+        struct level *here = levels + depth;
+        for (int i = 0; i < nedges && i < max_edges; i++) {
+            struct edge *e = edges + i;
+            if (e->playouts < min_playouts)
+                break;
+            here->nshown++;
+            yavalath_bit_to_notation(move, e->move);
+            printf("%*s  %-4s %10" PRIu64 " %+8.4f  ", depth * 2, "", move,
+                   e->playouts, e->reward / e->playouts);
+            switch (e->kind) {
+                case 0:
+                    printf("#%" PRIu64 "\n", e->child);
+                    break;
+                case 1:
+                case 2:
+                    printf("%c wins\n", "ox"[e->kind - 1]);
+                    break;
+                default:
+                    printf("draw\n");
+            }
+        }
+    }
+    fprintf(stderr, "yavalath-tree: %lu nodes\n", nodes);
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "weights.h"
+
+int
+weights_load(const char *path, float *weights, int count)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return 0;
+    unsigned char header[8];
+    int ok = fread(header, sizeof(header), 1, f) == 1 &&
+             !memcmp(header, "YAVW", 4) && header[4] == 1 &&
+             (header[6] | header[7] << 8) == count;
+    for (int i = 0; ok && i < count; i++) {
+        unsigned char b[4];
+        ok = fread(b, sizeof(b), 1, f) == 1;
+        uint32_t bits = b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+        memcpy(weights + i, &bits, sizeof(bits));
+    }
+    fclose(f);
+    return ok;
+}
+
+int
+weights_save(const char *path, const float *weights, int count)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return 0;
+    unsigned char header[8] = {'Y', 'A', 'V', 'W', 1, 0, count, count >> 8};
+    int ok = fwrite(header, sizeof(header), 1, f) == 1;
+    for (int i = 0; ok && i < count; i++) {
+        uint32_t bits;
+        memcpy(&bits, weights + i, sizeof(bits));
+        unsigned char b[4] = {bits, bits >> 8, bits >> 16, bits >> 24};
+        ok = fwrite(b, sizeof(b), 1, f) == 1;
+    }
+    return fclose(f) == 0 && ok;
+}
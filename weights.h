@@ -0,0 +1,18 @@
+/**
+ * Leaf evaluator weights files, shared by the Yavalath frontends.
+ *
+ * A file is "YAVW", a u8 version (1), a u8 0, a u16 weight count, and
+ * then the weights as IEEE floats, all little-endian.
+ */
+
+/**
+ * Read exactly count weights from a file. Returns 0 on failure.
+ */
+int
+weights_load(const char *path, float *weights, int count);
+
+/**
+ * Write count weights to a file. Returns 0 on failure.
+ */
+int
+weights_save(const char *path, const float *weights, int count);
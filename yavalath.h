@@ -1,13 +1,39 @@
 /**
  * Yavalath AI and Engine
  *
- * This AI represents the game state using two 64-bit bitboards, one
- * for each player's stones. As such, there are no fancy types to
- * declare and it is up to the caller to perform its own bit
- * operations, which are very simple.
+ * This AI represents the game state using two bitboards, one for each
+ * player's stones. On the standard radius-4 board these are plain
+ * 64-bit integers, so there are no fancy types to declare and it is
+ * up to the caller to perform its own bit operations, which are very
+ * simple.
+ *
+ * The board radius is fixed at compile time with YAVALATH_RADIUS, and
+ * tables.h must be generated for the same radius. Radius 5 (91 cells)
+ * and radius 6 (127 cells) boards use 128-bit bitboards, which requires
+ * a compiler with unsigned __int128.
  */
 #include <stdint.h>
 
+#ifndef YAVALATH_RADIUS
+#  define YAVALATH_RADIUS 4
+#endif
+
+#define YAVALATH_CELLS (3 * YAVALATH_RADIUS * (YAVALATH_RADIUS + 1) + 1)
+
+#if YAVALATH_CELLS <= 64
+typedef uint64_t yavalath_bitboard;
+#elif YAVALATH_CELLS <= 128 && defined(__SIZEOF_INT128__)
+typedef unsigned __int128 yavalath_bitboard;
+#else
+#  error "YAVALATH_RADIUS is unsupported on this compiler"
+#endif
+
+/* The bitboard with only the given bit set. */
+#define YAVALATH_BIT(bit) ((yavalath_bitboard)1 << (bit))
+
+/* Buffer size for Susan notation, including the terminator. */
+#define YAVALATH_NOTATION_MAX 4
+
 enum yavalath_game_result {
     YAVALATH_GAME_UNRESOLVED,
     YAVALATH_GAME_WIN,
@@ -20,6 +46,7 @@ enum yavalath_result {
     YAVALATH_BAILOUT_OVERFLOW = 10,
     YAVALATH_BAILOUT_MEMORY,
     YAVALATH_INVALID_ARGUMENT,
+    YAVALATH_STOPPED,
 };
 
 /**
@@ -35,7 +62,7 @@ yavalath_hex_to_bit(int q,
 /**
  * Convert bit to axial coordinates.
  *
- * The bit must be within [0 - 61).
+ * The bit must be within [0 - YAVALATH_CELLS).
  * See: http://www.redblobgames.com/grids/hexagons/
  */
 void
@@ -54,8 +81,8 @@ yavalath_notation_to_bit(const char *notation);
 /**
  * Convert a bit to its Susan notation.
  *
- * The bit must be within [0 - 61), and exactly three bytes will be
- * written to the buffer.
+ * The bit must be within [0 - YAVALATH_CELLS), and at most
+ * YAVALATH_NOTATION_MAX bytes will be written to the buffer.
  */
 void
 yavalath_bit_to_notation(char *notation,
@@ -71,10 +98,10 @@ yavalath_bit_to_notation(char *notation,
  * Note: The game state is not validated, so there are no errors.
  */
 enum yavalath_game_result
-yavalath_check(uint64_t  who,
-               uint64_t  opponent,
-               int       bit,
-               uint64_t *where);
+yavalath_check(yavalath_bitboard  who,
+               yavalath_bitboard  opponent,
+               int                bit,
+               yavalath_bitboard *where);
 
 /**
  * Initialize a buffer for use as a Yavalath AI.
@@ -92,10 +119,16 @@ yavalath_check(uint64_t  who,
  *
  * The bufsize must be at least several megabytes, typically several
  * gigabytes. Ideally it will be just large enough to avoid cutting
- * playouts short due to memory exhaustion.
+ * playouts short due to memory exhaustion. Only a small index (about
+ * 0.5% of the buffer) is cleared here. The rest of the buffer is
+ * touched only as nodes are needed, so untouched pages from mmap() or
+ * calloc() remain unbacked until the search actually uses them.
+ *
+ * On boards with 128-bit bitboards the buffer must be aligned as by
+ * malloc().
  *
  * The player0 and player1 values must not have overlapping bits, nor
- * may the upper 3 bits be set.
+ * may any bit at or above YAVALATH_CELLS be set.
  *
  * Different seeds will slightly change the AI's choices, leading to
  * different games for the same opponent moves. A seed of 0 is
@@ -107,11 +140,177 @@ yavalath_check(uint64_t  who,
  *   YAVALATH_INVALID_ARGUMENT : bufsize too small, or invalid game state
  */
 enum yavalath_result
-yavalath_ai_init(void    *buf,
-                 size_t   bufsize,
-                 uint64_t player0,
-                 uint64_t player1,
-                 uint64_t seed);
+yavalath_ai_init(void              *buf,
+                 size_t             bufsize,
+                 yavalath_bitboard  player0,
+                 yavalath_bitboard  player1,
+                 uint64_t           seed);
+
+/**
+ * Like `yavalath_ai_init()`, but for a buffer already filled with zeros.
+ *
+ * Freshly mapped memory (mmap(), VirtualAlloc(), or a large calloc())
+ * is zero-filled by the operating system, and initialization can then
+ * skip clearing the index entirely. This takes constant time regardless
+ * of bufsize.
+ */
+enum yavalath_result
+yavalath_ai_init_zeroed(void              *buf,
+                        size_t             bufsize,
+                        yavalath_bitboard  player0,
+                        yavalath_bitboard  player1,
+                        uint64_t           seed);
+
+/* Number of weights in a leaf evaluator. */
+#define YAVALATH_EVAL_WEIGHTS (81 + 27 + 1)
+
+/**
+ * Compute the leaf evaluator's features for a position.
+ * who      : stones of the player to move
+ * opponent : the other player's stones
+ * features : (output) YAVALATH_EVAL_WEIGHTS values
+ *
+ * Every line of four cells is read in increasing bit order as a
+ * base-3 number, each cell being empty (0), who's (1), or opponent's
+ * (2), and the first 81 features count the lines with each pattern.
+ * The next 27 do the same for lines of three cells, and the last is
+ * always 1. The evaluator estimates the reward to `who` as the tanh of
+ * the dot product of these features with its weights.
+ */
+void
+yavalath_eval_features(yavalath_bitboard who,
+                       yavalath_bitboard opponent,
+                       float            *features);
+
+/**
+ * Install a leaf evaluator to replace or blend with random playouts.
+ * buf     : the buffer
+ * weights : YAVALATH_EVAL_WEIGHTS weights, copied into the buffer
+ * mix     : share of each new leaf's value taken from the evaluator
+ *
+ * A mix of 0 uses random playouts alone, as after initialization. A
+ * mix of 1 skips playouts entirely, so each new node costs one table
+ * driven evaluation instead of a few dozen random plies. Anything in
+ * between blends the two. Weights may be NULL when mix is 0. Call this
+ * again after every `yavalath_ai_init()`.
+ *
+ * Possible return values:
+ *   YAVALATH_SUCCESS
+ *   YAVALATH_INVALID_ARGUMENT : mix outside [0, 1], or missing weights
+ */
+enum yavalath_result
+yavalath_ai_set_evaluator(void        *buf,
+                          const float *weights,
+                          float        mix);
+
+#define YAVALATH_INFLIGHT_MAX 16
+
+/**
+ * Interleave several playouts on the calling thread.
+ * buf      : the buffer
+ * inflight : playouts in flight at once, 1 to YAVALATH_INFLIGHT_MAX
+ *
+ * Each descent through a large tree is a chain of dependent cache
+ * misses. With more than one in flight, the search steps through them
+ * in turn, one node each, prefetching the node each will visit next,
+ * so that their memory latency overlaps. A move taken by a descent in
+ * flight counts as a loss until its result arrives, which spreads the
+ * descents over different lines. The default of 1 runs playouts one at
+ * a time. Searches stay reproducible for a given seed and setting. Call
+ * this again after every `yavalath_ai_init()`.
+ *
+ * Possible return values:
+ *   YAVALATH_SUCCESS
+ *   YAVALATH_INVALID_ARGUMENT : inflight out of range
+ */
+enum yavalath_result
+yavalath_ai_set_inflight(void *buf,
+                         int   inflight);
+
+/**
+ * Prepare memory for use as a shared analysis cache.
+ * cache : the cache memory, page aligned
+ * size  : size of the cache memory in bytes
+ *
+ * A cache holds the root move statistics of searched positions, so
+ * that a new search of a popular position, such as an opening, starts
+ * from what earlier searches learned. It is meant to live in shared
+ * memory mapped by many processes at once: it has no locks, and
+ * readers and writers in any number of threads or processes never
+ * wait on one another. The memory must be zero-filled when first
+ * prepared (as a new mapping is), and every process may then call
+ * this on its own mapping. Each entry takes about 8 bytes per cell,
+ * and positions that do not fit replace the least searched ones.
+ *
+ * Possible return values:
+ *   YAVALATH_SUCCESS
+ *   YAVALATH_INVALID_ARGUMENT : too small, prepared by an incompatible
+ *                               build, or unsupported by this compiler
+ */
+enum yavalath_result
+yavalath_cache_init(void  *cache,
+                    size_t size);
+
+/**
+ * Attach a shared analysis cache to an AI buffer.
+ * buf   : the buffer
+ * cache : memory prepared by `yavalath_cache_init()`, or NULL to detach
+ * size  : size of the cache memory in bytes
+ * prior : most playouts seeded into a new node from the cache
+ *
+ * Every node allocated from then on, and the root if not yet searched,
+ * has its unexplored moves seeded with the cached statistics for its
+ * position, scaled down to at most prior playouts in total. Seeded
+ * playouts count like real ones, so a small prior lets the search
+ * overrule the cache quickly. Call this again after every
+ * `yavalath_ai_init()`.
+ *
+ * Possible return values:
+ *   YAVALATH_SUCCESS
+ *   YAVALATH_INVALID_ARGUMENT : the cache is not prepared or too small
+ */
+enum yavalath_result
+yavalath_ai_set_cache(void    *buf,
+                      void    *cache,
+                      size_t   size,
+                      uint32_t prior);
+
+/**
+ * Publish the search tree to the attached cache.
+ * buf          : the buffer
+ * min_playouts : skip nodes with fewer playouts
+ *
+ * Stores the statistics of the root and of every node reached through
+ * moves with at least min_playouts, replacing cached entries for the
+ * same positions only when they have fewer playouts. Call this after
+ * a search. Returns the number of positions offered to the cache.
+ */
+uint64_t
+yavalath_ai_publish(const void *buf,
+                    uint64_t    min_playouts);
+
+/**
+ * Change the size of an initialized AI buffer, keeping its search tree.
+ * buf     : the buffer
+ * newsize : new total size of the buffer
+ *
+ * To grow, first enlarge the buffer (e.g. with realloc(), which may
+ * move it), then call this function on the enlarged buffer. To shrink,
+ * call this function first and then truncate the buffer. Shrinking
+ * moves nodes from the truncated region into free nodes below it.
+ *
+ * The hash index is rebuilt from scratch: every slot of the new index
+ * is cleared and every node ever used is rescanned, so the cost grows
+ * with the new size and the high-water mark of the tree, not with the
+ * amount of growth. No search statistics are lost.
+ *
+ * Possible return values:
+ *   YAVALATH_SUCCESS
+ *   YAVALATH_INVALID_ARGUMENT : newsize cannot hold the nodes in use
+ */
+enum yavalath_result
+yavalath_ai_resize(void  *buf,
+                   size_t newsize);
 
 /**
  * Advance the AI's internal game state forward.
@@ -129,6 +328,20 @@ enum yavalath_result
 yavalath_ai_advance(void *buf,
                     int   bit);
 
+/**
+ * Compact the AI's search tree for better memory locality.
+ *
+ * After many advances the surviving nodes are scattered throughout
+ * the buffer. This relocates them into breadth-first order at the
+ * front of the buffer, so that searches touch fewer cache lines and
+ * pages, and makes all remaining space contiguous. A good time to call
+ * this is right after `yavalath_ai_advance()`. It takes time
+ * proportional to the number of nodes ever used and is never
+ * required for correctness.
+ */
+void
+yavalath_ai_compact(void *buf);
+
 /**
  * Try to perform a given number of playouts.
  *
@@ -138,6 +351,11 @@ yavalath_ai_advance(void *buf,
  * game state. The game must advance at least one turn (releasing
  * resources) before more playouts are possible.
  *
+ * Playout counters are 32 bits, so a search from one game state
+ * stops at about 4.29 billion playouts. Building with YAVALATH_WIDE
+ * defined to 1 switches to 64-bit counters and node indices and
+ * double precision rewards, at the cost of larger nodes.
+ *
  * Possible return values:
  *   YAVALATH_SUCCESS
  *   YAVALATH_BAILOUT_OVERFLOW : further playouts would overflow an integer
@@ -147,6 +365,109 @@ enum yavalath_result
 yavalath_ai_playout(void    *buf,
                     uint32_t num_playouts);
 
+/**
+ * A snapshot of a search in progress, given to a progress callback.
+ */
+struct yavalath_progress {
+    int      best_move;         // current best move, or -1 if none yet
+    double   score;             // its `yavalath_ai_get_move_score()`
+    uint64_t playouts;          // playouts completed by this call
+    uint64_t total_playouts;    // playouts through the current root
+    uint64_t nodes_used;
+    uint64_t nodes_total;
+};
+
+/**
+ * Called periodically during `yavalath_ai_search()`. Return non-zero
+ * to stop the search.
+ */
+typedef int (*yavalath_progress_fn)(const struct yavalath_progress *,
+                                    void *arg);
+
+/**
+ * Like `yavalath_ai_playout()`, with progress reports and cancellation.
+ * buf          : the buffer
+ * num_playouts : maximum number of playouts
+ * interval     : playouts between calls to callback
+ * callback     : progress callback (may be NULL)
+ * arg          : passed through to callback
+ * stop         : stop flag (may be NULL)
+ *
+ * The callback runs on the calling thread between playouts, so it may
+ * use the other functions on this buffer. The stop flag is checked
+ * before every playout, so setting it to non-zero from another thread
+ * or a signal handler ends the search within one playout, typically a
+ * few microseconds. The search does not clear the flag.
+ *
+ * Unlike `yavalath_ai_best_move()`, the reported best move breaks ties
+ * by playouts rather than randomly, so reports do not disturb the
+ * search's random number sequence.
+ *
+ * Possible return values are those of `yavalath_ai_playout()`, plus:
+ *   YAVALATH_STOPPED : the callback or stop flag ended the search
+ */
+enum yavalath_result
+yavalath_ai_search(void                *buf,
+                   uint32_t             num_playouts,
+                   uint32_t             interval,
+                   yavalath_progress_fn callback,
+                   void                *arg,
+                   volatile int        *stop);
+
+/**
+ * Per-move time manager for a game clock with an increment.
+ *
+ * `yavalath_timer_start()` plans the move, filling in target and
+ * limit. The remaining fields are private.
+ *
+ * Note: this keeps a game within its clock but has not been shown to
+ * play stronger than an equal fixed time per move (97-103 over 200
+ * games).
+ */
+struct yavalath_timer {
+    uint64_t target;            // msecs the move should take
+    uint64_t limit;             // msecs the move must not exceed
+    uint64_t playouts;
+    double   reference;
+    int      referenced;
+    int      forced;
+};
+
+/**
+ * Plan the time for the next move from a game clock.
+ * timer     : (output) the plan
+ * buf       : the buffer, positioned at the move to be made
+ * remaining : msecs left on the player's clock
+ * increment : msecs added to the clock after each move
+ *
+ * The budget is the remaining time spread over the moves the game is
+ * likely to last, judged by the empty cells left, plus most of the
+ * increment. A move with only one sensible reply gets no time at all.
+ */
+void
+yavalath_timer_start(struct yavalath_timer *timer,
+                     const void            *buf,
+                     uint64_t               remaining,
+                     uint64_t               increment);
+
+/**
+ * Decide whether a timed search should stop.
+ * timer   : the plan from `yavalath_timer_start()`
+ * buf     : the buffer being searched
+ * elapsed : msecs spent on this move so far
+ *
+ * Call this often during the search, e.g. from a progress callback,
+ * and stop when it returns non-zero. It never stops a search before
+ * the root has a move to choose. Searches stop short of the target
+ * when the root visits are concentrated on one move, or when the
+ * runner-up can no longer catch up in the time left, and run past the
+ * target, up to the limit, while the best move's score is falling.
+ */
+int
+yavalath_timer_check(struct yavalath_timer *timer,
+                     const void            *buf,
+                     uint64_t               elapsed);
+
 /**
  * Return the believed best move from the current game state.
  *
@@ -166,10 +487,72 @@ yavalath_ai_best_move(void *buf);
 double
 yavalath_ai_get_move_score(const void *buf, int bit);
 
+/**
+ * Return the number of playouts through the given move.
+ *
+ * Together with `yavalath_ai_get_move_score()`, the mean reward, this
+ * is the AI's complete statistic for a root move. Statistics from
+ * independent searches of the same position can be combined by
+ * summing playouts and score * playouts for each move.
+ */
+uint64_t
+yavalath_ai_get_move_playouts(const void *buf, int bit);
+
+/**
+ * Extract the principal variation, following the most visited move
+ * from the root until the tree ends.
+ * buf    : the buffer
+ * moves  : (output) the variation, starting with the root move
+ * maxlen : capacity of moves
+ *
+ * Returns the number of moves written.
+ */
+int
+yavalath_ai_get_pv(const void *buf, int *moves, int maxlen);
+
+/**
+ * Sink for `yavalath_ai_dump()`. Returns 0 on success.
+ */
+typedef int (*yavalath_write_fn)(const void *data, size_t len, void *arg);
+
+/**
+ * Stream the live search tree in a compact binary format.
+ * buf          : the buffer
+ * max_depth    : deepest node to write (0 for the root only)
+ * min_playouts : skip subtrees reached by fewer playouts
+ * write        : called with each record in turn
+ * arg          : passed through to write
+ *
+ * Nodes are written depth first from the root, each once per path
+ * that reaches it within the cutoffs, so a shared transposition may
+ * appear more than once under the same id. The tree is only read, so
+ * this may be called between playouts, e.g. from a progress callback,
+ * without disturbing the search. Memory use is constant.
+ *
+ * All integers are little-endian and rewards are IEEE doubles:
+ *   header : "YAVT", u8 version (1), u8 cells, u8 root turn, u8 0
+ *   node   : u8 depth, u8 turn, u8 edge count, u8 0, u64 id,
+ *            u64 playouts, player 0 then player 1 stones as
+ *            (cells + 63) / 64 u64 words each, then the edges
+ *   edge   : u8 move, u8 kind, u64 playouts, f64 reward sum, u64 child
+ * Edge kinds are 0 (child node id follows), 1 (player 0 won), 2
+ * (player 1 won), and 3 (draw). Only edges with playouts are written.
+ *
+ * Possible return values:
+ *   YAVALATH_SUCCESS
+ *   YAVALATH_STOPPED : the write function failed
+ */
+enum yavalath_result
+yavalath_ai_dump(const void        *buf,
+                 int                max_depth,
+                 uint64_t           min_playouts,
+                 yavalath_write_fn  write,
+                 void              *arg);
+
 /**
  * Return the total number of nodes available to the AI.
  */
-uint32_t
+uint64_t
 yavalath_ai_get_nodes_total(const void *buf);
 
 /**
@@ -178,11 +561,11 @@ yavalath_ai_get_nodes_total(const void *buf);
  * Dividing this by the total number of nodes gives a close
  * approximation to the percentage of the AI buffer in use.
  */
-uint32_t
+uint64_t
 yavalath_ai_get_nodes_used(const void *buf);
 
 /**
  * Return the total number of playouts through the current root.
  */
-uint32_t
+uint64_t
 yavalath_ai_get_total_playouts(const void *buf);
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include "yavalath.h"
 #include "tables.h"
 
@@ -9,29 +10,81 @@
 #  define YAVALATH_C  0.5f
 #endif
 
+/* Prefetch nodes along the descent path (0 to disable). */
+#ifndef YAVALATH_PREFETCH
+#  define YAVALATH_PREFETCH 1
+#endif
+
+/* Blend all-moves-as-first statistics into UCB1 (0 to disable). The
+ * equivalence parameter is the number of playouts of a move at which
+ * its own mean and its AMAF mean are given roughly equal weight.
+ */
+#ifndef YAVALATH_RAVE
+#  define YAVALATH_RAVE 0
+#endif
+
+#ifndef YAVALATH_RAVE_K
+#  define YAVALATH_RAVE_K 500.0f
+#endif
+
+/* Restrict new nodes to forced replies and skip suicidal moves. */
+#ifndef YAVALATH_PRUNE
+#  define YAVALATH_PRUNE 1
+#endif
+
+/* Keep value statistics on nodes rather than edges, so that every
+ * path into a transposition shares what any of them learned. Edge
+ * playout counts still drive exploration.
+ */
+#ifndef YAVALATH_DAG
+#  define YAVALATH_DAG 0
+#endif
+
+/* Support the shared analysis cache, which needs atomic operations. */
+#if !defined(YAVALATH_CACHE) && defined(__GNUC__)
+#  define YAVALATH_CACHE 1
+#elif !defined(YAVALATH_CACHE)
+#  define YAVALATH_CACHE 0
+#endif
+
+#if YAVALATH_PREFETCH && defined(__GNUC__)
+#  define PREFETCH(p) __builtin_prefetch(p)
+#else
+#  define PREFETCH(p) ((void)(p))
+#endif
+
 #define REWARD_WIN   1.0f
 #define REWARD_DRAW -0.1f
 #define REWARD_LOSS -1.0f
 
 #define DRAW  100
 
+/* Board geometry, fixed at compile time by YAVALATH_RADIUS. */
+#define RADIUS YAVALATH_RADIUS
+#define CELLS  YAVALATH_CELLS
+#define SPAN   (2 * RADIUS + 1)
+#define BIT    YAVALATH_BIT
+#define FULL   (BIT(CELLS - 1) * 2 - 1)  // every cell on the board
+
+typedef yavalath_bitboard bitboard;
+
 static int
 hex_to_bit(int q, int r)
 {
-    if (q < -4 || q > 4 || r < -4 || r > 4)
+    if (q < -RADIUS || q > RADIUS || r < -RADIUS || r > RADIUS)
         return -1;
     else
-        return store_map[q + 4][r + 4];
+        return store_map[q + RADIUS][r + RADIUS];
 }
 static int
 bit_to_hex(int bit, int *q, int *r)
 {
     // TODO: closed form
-    for (int i = 0; i < 9; i++)
-        for (int j = 0; j < 9; j++)
+    for (int i = 0; i < SPAN; i++)
+        for (int j = 0; j < SPAN; j++)
             if (store_map[i][j] == bit) {
-                *q = i - 4;
-                *r = j - 4;
+                *q = i - RADIUS;
+                *r = j - RADIUS;
                 return 1;
             }
     return 0;
@@ -64,87 +117,211 @@ splitmix64(uint64_t *x)
     return z ^ (z >> 31);
 }
 
+/* Susan notation numbers each row from 1 starting at its leftmost
+ * cell, so the offset from r depends on how far the row is clipped.
+ */
+static int
+notation_offset(int q)
+{
+    return RADIUS + 1 + (q < 0 ? q : 0);
+}
+
 static int
 notation_to_hex(const char *s, int *q, int *r)
 {
-    if (s[0] < 'a' || s[1] > 'i')
+    if (s[0] < 'a' || s[0] >= 'a' + SPAN)
         return 0;
     if (s[1] < '1' || s[1] > '9')
         return 0;
-    *q = s[0] - 'a' - 4;
-    *r = s[1] - "123455555"[*q + 4];
+    int n = s[1] - '0';
+    if (SPAN > 9 && s[2] >= '0' && s[2] <= '9')
+        n = n * 10 + s[2] - '0';
+    *q = s[0] - 'a' - RADIUS;
+    *r = n - notation_offset(*q);
     return 1;
 }
 
 static int
 hex_to_notation(char *s, int q, int r)
 {
-    if (q < -4 || q > 4 || r < -4 || r > 4)
+    if (q < -RADIUS || q > RADIUS || r < -RADIUS || r > RADIUS)
         return 0;
-    s[0] = q + 'a' + 4;
-    s[1] = r + "123455555"[q + 4];
-    s[2] = 0;
+    int n = r + notation_offset(q);
+    *s++ = q + 'a' + RADIUS;
+    if (n > 9)
+        *s++ = '0' + n / 10;
+    *s++ = '0' + n % 10;
+    *s = 0;
     return 1;
 }
 
 static enum yavalath_game_result
-check(uint64_t who, uint64_t opponent, int where, uint64_t *how)
+check(bitboard who, bitboard opponent, int where, bitboard *how)
 {
     for (int i = 0; i < 12; i++) {
-        uint64_t mask = pattern_win[where][i];
+        bitboard mask = pattern_win[where][i];
         if (mask && (who & mask) == mask) {
             *how = mask;
             return YAVALATH_GAME_WIN;
         }
     }
     for (int i = 0; i < 9; i++) {
-        uint64_t mask = pattern_lose[where][i];
+        bitboard mask = pattern_lose[where][i];
         if (mask && (who & mask) == mask) {
             *how = mask;
             return YAVALATH_GAME_LOSS;
         }
     }
     *how = 0;
-    if ((who | opponent) == UINT64_C(0x1fffffffffffffff))
+    if ((who | opponent) == FULL)
         return YAVALATH_GAME_DRAW;
     return YAVALATH_GAME_UNRESOLVED;
 }
 
+/* Fold a bitboard into 64 bits for hashing. */
 static uint64_t
-state_hash(uint64_t a, uint64_t b)
+fold(bitboard x)
+{
+#if CELLS > 64
+    return (uint64_t)x ^ (uint64_t)(x >> 64) * UINT64_C(0x9E3779B97F4A7C15);
+#else
+    return x;
+#endif
+}
+
+static uint64_t
+state_hash(bitboard a, bitboard b)
 {
     uint64_t rng[2];
-    rng[0] = splitmix64(&a);
-    rng[1] = splitmix64(&b);
+    uint64_t x = fold(a);
+    uint64_t y = fold(b);
+    rng[0] = splitmix64(&x);
+    rng[1] = splitmix64(&y);
     return xoroshiro128plus(rng);
 }
 
-#define MCTS_NULL      ((uint32_t)-1)
-#define MCTS_DRAW      ((uint32_t)-2)
-#define MCTS_WIN0      ((uint32_t)-3)
-#define MCTS_WIN1      ((uint32_t)-4)
+#define LINES_WIN  (sizeof(lines_win) / sizeof(*lines_win))
+#define LINES_LOSE (sizeof(lines_lose) / sizeof(*lines_lose))
+
+/* Evaluator weights: one per pattern of a four-cell line, one per
+ * pattern of a three-cell line, and a bias.
+ */
+#define EVAL_WIN     81
+#define EVAL_LOSE    27
+#define EVAL_WEIGHTS YAVALATH_EVAL_WEIGHTS
+
+/* Base-3 pattern of a line, reading its cells in increasing bit order
+ * as empty (0), mine (1), or theirs (2).
+ */
+static int
+line_pattern(bitboard line, bitboard me, bitboard them)
+{
+    int pattern = 0;
+    for (int scale = 1; line; line &= line - 1, scale *= 3) {
+        bitboard cell = line & -line;
+        pattern += scale * ((me & cell) ? 1 : (them & cell) ? 2 : 0);
+    }
+    return pattern;
+}
+
+/* Wide mode uses 64-bit counters and node indices, and double reward
+ * sums, for very long searches in very large buffers. Nodes are
+ * roughly twice as large.
+ */
+#ifndef YAVALATH_WIDE
+#  define YAVALATH_WIDE 0
+#endif
+
+#if YAVALATH_WIDE
+typedef uint64_t mcts_index;
+typedef uint64_t mcts_count;
+typedef double   mcts_reward;
+#  define MCTS_COUNT_MAX UINT64_MAX
+#  define mcts_log       log
+#  define mcts_sqrt      sqrt
+#else
+typedef uint32_t mcts_index;
+typedef uint32_t mcts_count;
+typedef float    mcts_reward;
+#  define MCTS_COUNT_MAX UINT32_MAX
+#  define mcts_log       logf
+#  define mcts_sqrt      sqrtf
+#endif
+
+#define MCTS_NULL      ((mcts_index)-1)
+#define MCTS_DRAW      ((mcts_index)-2)
+#define MCTS_WIN0      ((mcts_index)-3)
+#define MCTS_WIN1      ((mcts_index)-4)
+#define MCTS_PRUNED    ((mcts_index)-5)
+#define MCTS_LIMIT     MCTS_PRUNED  // lowest sentinel, not a node
+
+/* Shared analysis cache: root statistics of searched positions, kept
+ * in memory that may be mapped into many processes at once. Each
+ * entry is guarded by a sequence lock, odd while a writer is busy, so
+ * readers never block and simply miss on a torn read. A writer that
+ * finds an entry busy skips it rather than wait.
+ */
+#define CACHE_MAGIC   (UINT64_C(0x59415643) << 32 | 1 << 16 | CELLS)
+#define CACHE_BUCKET  4           // entries probed per position
+
+struct cache {
+    uint64_t magic;               // layout check, zero until attached
+    uint64_t reserved;
+    struct cache_entry {
+        uint64_t version;         // sequence lock
+        bitboard state[2];
+        uint32_t turn;            // player to move
+        uint32_t total;           // playouts behind these statistics
+        uint32_t playouts[CELLS];
+        float    mean[CELLS];     // reward to the player to move
+    } entries[];
+};
+
 struct mcts {
     uint64_t rng[2];              // random number state
-    uint32_t root;                // root node index
-    uint32_t free;                // index of head of free list
-    uint32_t nodes_avail;         // total nodes available
-    uint32_t nodes_allocated;     // total number allocated
+    mcts_index root;              // root node index
+    mcts_index free;              // index of head of free list
+    mcts_index nodes_avail;       // total nodes available
+    mcts_index nodes_allocated;   // total number allocated
+    mcts_index nodes_fresh;       // index of first never-used node
     int root_turn;                // whose turn it is at root node
+    float eval_mix;               // evaluator share of leaf values
+    float eval[EVAL_WEIGHTS];     // evaluator weights
+    struct cache *cache;          // shared statistics, or NULL
+    uint64_t cache_entries;       // number of entries in cache
+    uint32_t cache_prior;         // most playouts seeded into a node
+    int inflight;                 // descents interleaved per search
     struct mcts_node {
-        uint32_t head;            // head of hash list for this slot
-        uint32_t chain;           // next item in hash table list
-        uint64_t state[2];        // the game state at this node
-        uint32_t total_playouts;  // number of playouts through this node
-        float    reward[61];      // win counter for each move
-        uint32_t playouts[61];    // number of playouts for this play
-        uint32_t next[61];        // next node when taking this play
+        mcts_index chain;         // next item in hash table list
         uint16_t refcount;        // number of nodes referencing this node
         uint8_t  unexplored;      // count of unexplored
+        mcts_count total_playouts; // playouts through this node
+#if YAVALATH_DAG
+        mcts_count visits;        // playouts through here from any parent
+        mcts_reward value;        // their reward to the player who moved here
+#endif
+        bitboard state[2];        // the game state at this node
+        mcts_reward reward[CELLS];   // win counter for each move
+        mcts_count playouts[CELLS];  // number of playouts for this play
+        mcts_index next[CELLS];      // next node when taking this play
+#if YAVALATH_RAVE
+        mcts_reward amaf_reward[CELLS];  // reward when played later
+        mcts_count amaf_playouts[CELLS]; // playouts where played later
+#endif
     } nodes[];
 };
 
-static uint32_t
-mcts_find(struct mcts *m, uint32_t list_head, const uint64_t state[2])
+/* The hash table heads follow the nodes. Entries are stored inverted
+ * so that zero-filled memory is already an empty table.
+ */
+static mcts_index *
+mcts_heads(struct mcts *m)
+{
+    return (mcts_index *)(m->nodes + m->nodes_avail);
+}
+
+static mcts_index
+mcts_find(struct mcts *m, mcts_index list_head, const bitboard state[2])
 {
     while (list_head != MCTS_NULL) {
         struct mcts_node *n = m->nodes + list_head;
@@ -155,12 +332,152 @@ mcts_find(struct mcts *m, uint32_t list_head, const uint64_t state[2])
     return MCTS_NULL;
 }
 
-static uint32_t
-mcts_alloc(struct mcts *m, const uint64_t state[2])
+/* Prefetch the part of a node read when selecting its next move. */
+static void
+mcts_prefetch(const struct mcts_node *n)
 {
-    uint64_t hash = state_hash(state[0], state[1]);
-    uint32_t *head = &m->nodes[hash % m->nodes_avail].head;
-    uint32_t nodei = mcts_find(m, *head, state);
+    const char *p = (const char *)n;
+    for (size_t i = 0; i < offsetof(struct mcts_node, next); i += 64)
+        PREFETCH(p + i);
+}
+
+#if YAVALATH_PRUNE
+/* Empty cells that would complete one of the lines for a player. */
+static bitboard
+completions(const bitboard *lines, size_t nlines, bitboard who,
+            bitboard empty)
+{
+    bitboard cells = 0;
+    for (size_t i = 0; i < nlines; i++) {
+        bitboard missing = lines[i] & ~who;
+        if (!(missing & (missing - 1)) && (missing & empty))
+            cells |= missing;
+    }
+    return cells;
+}
+#endif
+
+/**
+ * Return the moves worth exploring for the player to move. An
+ * immediate win is always taken, a threatened opponent win must be
+ * blocked, and moves forming three-in-a-row are skipped unless
+ * nothing else is left.
+ */
+static bitboard
+mcts_prune(const bitboard state[2], int turn)
+{
+    bitboard me = state[turn];
+    bitboard opponent = state[!turn];
+    bitboard empty = ~(me | opponent) & FULL;
+#if YAVALATH_PRUNE
+    bitboard wins = completions(lines_win, LINES_WIN, me, empty);
+    bitboard threats = completions(lines_win, LINES_WIN, opponent, empty);
+    bitboard losses = completions(lines_lose, LINES_LOSE, me, empty);
+    bitboard safe = empty & ~losses;
+    if (wins)
+        return wins;
+    if (threats & safe)
+        return threats & safe;
+    if (threats)
+        return threats; // lost regardless
+    if (safe)
+        return safe;
+#else
+    (void)turn;
+#endif
+    return empty;
+}
+
+#if YAVALATH_CACHE
+static struct cache_entry *
+cache_bucket(struct cache *c, uint64_t nentries, uint64_t hash)
+{
+    return c->entries + hash % (nentries / CACHE_BUCKET) * CACHE_BUCKET;
+}
+
+/* Copy out the entry for a position, returning 0 if there is none. */
+static int
+cache_lookup(struct cache *c, uint64_t nentries, uint64_t hash,
+             const bitboard state[2], int turn, struct cache_entry *out)
+{
+    struct cache_entry *e = cache_bucket(c, nentries, hash);
+    for (int i = 0; i < CACHE_BUCKET; i++, e++) {
+        uint64_t v = __atomic_load_n(&e->version, __ATOMIC_ACQUIRE);
+        if ((v & 1) || e->state[0] != state[0] || e->state[1] != state[1])
+            continue;
+        memcpy(out, e, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&e->version, __ATOMIC_RELAXED) != v)
+            return 0;  // overwritten while reading
+        return out->state[0] == state[0] && out->state[1] == state[1] &&
+               out->turn == (uint32_t)turn && out->total;
+    }
+    return 0;
+}
+
+/* Store an entry, replacing the same position only when it has more
+ * playouts, and otherwise the bucket's least searched entry.
+ */
+static void
+cache_store(struct cache *c, uint64_t nentries, uint64_t hash,
+            const struct cache_entry *in)
+{
+    struct cache_entry *bucket = cache_bucket(c, nentries, hash);
+    struct cache_entry *e = bucket;
+    for (int i = 0; i < CACHE_BUCKET; i++) {
+        struct cache_entry *x = bucket + i;
+        if (x->state[0] == in->state[0] && x->state[1] == in->state[1] &&
+            x->turn == in->turn) {
+            if (x->total > in->total)
+                return;
+            e = x;
+            break;
+        }
+        if (x->total < e->total)
+            e = x;
+    }
+    uint64_t v = __atomic_load_n(&e->version, __ATOMIC_RELAXED);
+    if ((v & 1) || !__atomic_compare_exchange_n(&e->version, &v, v + 1, 0,
+                                                 __ATOMIC_ACQ_REL,
+                                                 __ATOMIC_RELAXED))
+        return;  // another writer has it
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((char *)e + sizeof(e->version), (const char *)in +
+           sizeof(in->version), sizeof(*e) - sizeof(e->version));
+    __atomic_store_n(&e->version, v + 2, __ATOMIC_RELEASE);
+}
+
+/* Seed a new node's unexplored moves with cached statistics, scaled
+ * down to at most cache_prior playouts in total.
+ */
+static void
+mcts_seed(struct mcts *m, struct mcts_node *n, int turn, uint64_t hash)
+{
+    struct cache_entry e;
+    if (!cache_lookup(m->cache, m->cache_entries, hash, n->state, turn, &e))
+        return;
+    double scale = e.total > m->cache_prior ?
+                   m->cache_prior / (double)e.total : 1.0;
+    for (int i = 0; i < CELLS; i++) {
+        mcts_count count = e.playouts[i] * scale + 0.5;
+        if (count && n->next[i] == MCTS_NULL &&
+            !(((n->state[0] | n->state[1]) >> i) & 1)) {
+            n->playouts[i] = count;
+            n->reward[i] = count * e.mean[i];
+            n->total_playouts += count;
+        }
+    }
+}
+#endif
+
+static mcts_index
+mcts_alloc_hashed(struct mcts *m,
+                  const bitboard state[2],
+                  int turn,
+                  uint64_t hash)
+{
+    mcts_index *head = mcts_heads(m) + hash % m->nodes_avail;
+    mcts_index nodei = mcts_find(m, ~*head, state);
     if (nodei != MCTS_NULL) {
         /* Node already exists, return it. */
         assert(m->nodes[nodei].refcount > 0);
@@ -171,6 +488,10 @@ mcts_alloc(struct mcts *m, const uint64_t state[2])
         nodei = m->free;
         m->free = m->nodes[m->free].chain;
         m->nodes_allocated++;
+    } else if (m->nodes_fresh < m->nodes_avail) {
+        /* Hand out a node that has never been touched. */
+        nodei = m->nodes_fresh++;
+        m->nodes_allocated++;
     } else {
         return MCTS_NULL;
     }
@@ -181,34 +502,57 @@ mcts_alloc(struct mcts *m, const uint64_t state[2])
     n->state[1] = state[1];
     n->refcount = 1;
     n->total_playouts = 0;
+#if YAVALATH_DAG
+    n->visits = 0;
+    n->value = 0.0f;
+#endif
     n->unexplored = 0;
-    n->chain = *head;
-    *head = nodei;
-    uint64_t taken = state[0] | state[1];
-    for (int i = 0; i < 61; i++) {
+    n->chain = ~*head;
+    *head = ~nodei;
+    bitboard taken = state[0] | state[1];
+    bitboard allowed = mcts_prune(state, turn);
+    for (int i = 0; i < CELLS; i++) {
         n->reward[i] = 0.0f;
         n->playouts[i] = 0;
         n->next[i] = MCTS_NULL;
-        if (!((taken >> i) & 1))
+#if YAVALATH_RAVE
+        n->amaf_reward[i] = 0.0f;
+        n->amaf_playouts[i] = 0;
+#endif
+        if ((allowed >> i) & 1)
             n->unexplored++;
+        else if (!((taken >> i) & 1))
+            n->next[i] = MCTS_PRUNED;
     }
+#if YAVALATH_CACHE
+    if (m->cache)
+        mcts_seed(m, n, turn, hash);
+#endif
     return nodei;
 }
 
+static mcts_index
+mcts_alloc(struct mcts *m, const bitboard state[2], int turn)
+{
+    uint64_t hash = state_hash(state[0], state[1]);
+    return mcts_alloc_hashed(m, state, turn, hash);
+}
+
 static void
-mcts_free(struct mcts *m, uint32_t node)
+mcts_free(struct mcts *m, mcts_index node)
 {
-    if (node < MCTS_WIN1) {
+    if (node < MCTS_LIMIT) {
         struct mcts_node *n = m->nodes + node;
         assert(n->refcount);
         if (--n->refcount == 0) {
             m->nodes_allocated--;
-            for (int i = 0; i < 61; i++)
+            for (int i = 0; i < CELLS; i++)
                 mcts_free(m, n->next[i]);
             uint64_t hash = state_hash(n->state[0], n->state[1]);
-            uint32_t parent = m->nodes[hash % m->nodes_avail].head;
+            mcts_index *head = mcts_heads(m) + hash % m->nodes_avail;
+            mcts_index parent = ~*head;
             if (parent == node) {
-                m->nodes[hash % m->nodes_avail].head = n->chain;
+                *head = ~n->chain;
             } else {
                 while (m->nodes[parent].chain != node)
                     parent = m->nodes[parent].chain;
@@ -220,25 +564,170 @@ mcts_free(struct mcts *m, uint32_t node)
     }
 }
 
+/* Number of nodes that fit in a buffer of the given size. */
+static mcts_index
+mcts_capacity(size_t bufsize)
+{
+    size_t per_node = sizeof(struct mcts_node) + sizeof(mcts_index);
+    if (bufsize < sizeof(struct mcts) + per_node)
+        return 0;
+    size_t nodes_avail = (bufsize - sizeof(struct mcts)) / per_node;
+    return nodes_avail > MCTS_LIMIT ? MCTS_LIMIT : nodes_avail;
+}
+
+/* Rebuild the hash table from scratch for the current nodes_avail:
+ * clear the whole index, then rescan every node below nodes_fresh.
+ */
+static void
+mcts_rehash(struct mcts *m)
+{
+    mcts_index *heads = mcts_heads(m);
+    memset(heads, 0, sizeof(*heads) * m->nodes_avail);
+    for (mcts_index i = 0; i < m->nodes_fresh; i++) {
+        struct mcts_node *n = m->nodes + i;
+        if (n->refcount) {
+            uint64_t hash = state_hash(n->state[0], n->state[1]);
+            mcts_index *head = heads + hash % m->nodes_avail;
+            n->chain = ~*head;
+            *head = ~i;
+        }
+    }
+}
+
+static int
+mcts_resize(struct mcts *m, size_t bufsize)
+{
+    mcts_index avail = mcts_capacity(bufsize);
+    if (avail < m->nodes_allocated || !avail)
+        return 0;
+    if (avail < m->nodes_fresh) {
+        /* Drop free nodes that fall beyond the new end. */
+        mcts_index *link = &m->free;
+        while (*link != MCTS_NULL) {
+            if (*link >= avail)
+                *link = m->nodes[*link].chain;
+            else
+                link = &m->nodes[*link].chain;
+        }
+
+        /* Move live nodes below the new end, leaving a forwarding
+         * index in the old node's chain.
+         */
+        for (mcts_index i = avail; i < m->nodes_fresh; i++) {
+            struct mcts_node *n = m->nodes + i;
+            if (n->refcount) {
+                mcts_index dest = m->free;
+                m->free = m->nodes[dest].chain;
+                m->nodes[dest] = *n;
+                n->chain = dest;
+            }
+        }
+        for (mcts_index i = 0; i < avail; i++) {
+            struct mcts_node *n = m->nodes + i;
+            if (n->refcount)
+                for (int j = 0; j < CELLS; j++)
+                    if (n->next[j] < MCTS_LIMIT && n->next[j] >= avail)
+                        n->next[j] = m->nodes[n->next[j]].chain;
+        }
+        if (m->root >= avail)
+            m->root = m->nodes[m->root].chain;
+        m->nodes_fresh = avail;
+    }
+    m->nodes_avail = avail;
+    mcts_rehash(m);
+    return 1;
+}
+
+/* Relocate the live tree into breadth-first order at the front of the
+ * node array, so that a descent walks nearby memory, and reset the
+ * allocator to hand out the space behind it.
+ */
+static void
+mcts_compact(struct mcts *m)
+{
+    mcts_index *heads = mcts_heads(m);
+
+    /* Empty the hash table and mark every live node unvisited. */
+    for (mcts_index i = 0; i < m->nodes_fresh; i++) {
+        struct mcts_node *n = m->nodes + i;
+        if (n->refcount) {
+            uint64_t hash = state_hash(n->state[0], n->state[1]);
+            heads[hash % m->nodes_avail] = 0;
+            n->chain = MCTS_NULL;
+        }
+    }
+
+    /* Number nodes breadth-first, using the empty table as the queue
+     * of old indices and each node's chain as its new index.
+     */
+    mcts_index count = 0;
+    heads[count] = m->root;
+    m->nodes[m->root].chain = count++;
+    for (mcts_index k = 0; k < count; k++) {
+        struct mcts_node *n = m->nodes + heads[k];
+        for (int i = 0; i < CELLS; i++) {
+            mcts_index child = n->next[i];
+            if (child < MCTS_LIMIT && m->nodes[child].chain == MCTS_NULL) {
+                m->nodes[child].chain = count;
+                heads[count++] = child;
+            }
+        }
+    }
+    assert(count == m->nodes_allocated);
+    for (mcts_index k = 0; k < count; k++) {
+        struct mcts_node *n = m->nodes + heads[k];
+        for (int i = 0; i < CELLS; i++)
+            if (n->next[i] < MCTS_LIMIT)
+                n->next[i] = m->nodes[n->next[i]].chain;
+    }
+    m->root = 0;
+
+    /* Apply the permutation in place, one cycle at a time. */
+    for (mcts_index i = 0; i < m->nodes_fresh; i++) {
+        while (m->nodes[i].refcount && m->nodes[i].chain != i) {
+            mcts_index dest = m->nodes[i].chain;
+            struct mcts_node tmp = m->nodes[dest];
+            m->nodes[dest] = m->nodes[i];
+            m->nodes[i] = tmp;
+        }
+    }
+
+    /* Everything past the tree is now unused. */
+    memset(heads, 0, sizeof(*heads) * count);
+    m->nodes_fresh = count;
+    m->free = MCTS_NULL;
+    for (mcts_index i = 0; i < count; i++) {
+        struct mcts_node *n = m->nodes + i;
+        uint64_t hash = state_hash(n->state[0], n->state[1]);
+        mcts_index *head = heads + hash % m->nodes_avail;
+        n->chain = ~*head;
+        *head = ~i;
+    }
+}
+
 static struct mcts *
 mcts_init(void *buf,
           size_t bufsize,
-          uint64_t state[2],
+          bitboard state[2],
           int turn,
-          uint64_t seed)
+          uint64_t seed,
+          int zeroed)
 {
     struct mcts *m = buf;
-    m->nodes_avail = (bufsize  - sizeof(*m)) / sizeof(m->nodes[0]);
+    m->nodes_avail = mcts_capacity(bufsize);
+    if (!m->nodes_avail)
+        return NULL;
     m->nodes_allocated = 0;
+    m->nodes_fresh = 0;
     m->rng[0] = splitmix64(&seed);
     m->rng[1] = splitmix64(&seed);
-    m->free = 0;
-    for (uint32_t i = 0; i < m->nodes_avail; i++) {
-        m->nodes[i].head = MCTS_NULL;
-        m->nodes[i].chain = i + 1;
-    }
-    m->nodes[m->nodes_avail - 1].chain = MCTS_NULL;
-    m->root = mcts_alloc(m, state);
+    m->free = MCTS_NULL;
+    m->eval_mix = 0.0f;
+    m->cache = NULL;
+    m->inflight = 1;
+    if (!zeroed)
+        memset(mcts_heads(m), 0, sizeof(mcts_index) * m->nodes_avail);
+    m->root = mcts_alloc(m, state, turn);
     m->root_turn = turn;
     return m->root == MCTS_NULL ? NULL : m;
 }
@@ -246,19 +735,19 @@ mcts_init(void *buf,
 static int
 mcts_advance(struct mcts *m, int tile)
 {
-    uint32_t old_root = m->root;
+    mcts_index old_root = m->root;
     struct mcts_node *root = m->nodes + old_root;
     if (((root->state[0] | root->state[1]) >> tile) & 1)
         return 0;
-    uint64_t state[2] = {root->state[0], root->state[1]};
-    state[m->root_turn] |= UINT64_C(1) << tile;
+    bitboard state[2] = {root->state[0], root->state[1]};
+    state[m->root_turn] |= BIT(tile);
     m->root_turn = !m->root_turn;
     m->root = root->next[tile];
     root->next[tile] = MCTS_NULL;  // prevents free
     mcts_free(m, old_root);
-    if (m->root >= MCTS_WIN1) {
+    if (m->root >= MCTS_LIMIT) {
         /* never explored this branch, allocate it */
-        m->root = mcts_alloc(m, state);
+        m->root = mcts_alloc(m, state, m->root_turn);
     }
     return 1;
 }
@@ -266,10 +755,10 @@ mcts_advance(struct mcts *m, int tile)
 static int
 random_play_from_remaining(struct mcts_node *n, uint64_t *rng)
 {
-    uint64_t taken = n->state[0] | n->state[1];
-    int options[61];
+    bitboard taken = n->state[0] | n->state[1];
+    int options[CELLS];
     int noptions = 0;
-    for (int i = 0; i < 61; i++)
+    for (int i = 0; i < CELLS; i++)
         if (!((taken >> i) & 1) && n->next[i] == MCTS_NULL)
             options[noptions++] = i;
     assert(noptions);
@@ -277,11 +766,11 @@ random_play_from_remaining(struct mcts_node *n, uint64_t *rng)
 }
 
 static int
-random_play_simple(uint64_t taken, uint64_t *rng)
+random_play_simple(bitboard taken, uint64_t *rng)
 {
-    int options[61];
+    int options[CELLS];
     int noptions = 0;
-    for (int i = 0; i < 61; i++)
+    for (int i = 0; i < CELLS; i++)
         if (!((taken >> i) & 1))
             options[noptions++] = i;
     assert(noptions);
@@ -289,15 +778,15 @@ random_play_simple(uint64_t taken, uint64_t *rng)
 }
 
 static int
-mcts_playout_final(uint64_t *rng, uint64_t *state, int initial_turn)
+mcts_playout_final(uint64_t *rng, bitboard *state, int initial_turn)
 {
     int turn = initial_turn;
     for (;;) {
         turn = !turn;
-        uint64_t taken = state[0] | state[1];
+        bitboard taken = state[0] | state[1];
         int play = random_play_simple(taken, rng);
-        state[turn] |= UINT64_C(1) << play;
-        uint64_t dummy;
+        state[turn] |= BIT(play);
+        bitboard dummy;
         switch (check(state[turn], state[!turn], play, &dummy)) {
             case YAVALATH_GAME_WIN:
                 return turn;
@@ -311,103 +800,442 @@ mcts_playout_final(uint64_t *rng, uint64_t *state, int initial_turn)
     }
 }
 
+/* Reward to the given player for a playout's winner. */
+static mcts_reward
+mcts_reward_for(int winner, int turn)
+{
+    if (winner == turn)
+        return REWARD_WIN;
+    else if (winner == !turn)
+        return REWARD_LOSS;
+    else if (winner == DRAW)
+        return REWARD_DRAW;
+    return 0;
+}
+
+/* Rewards to both players for a playout's winner. */
+static void
+mcts_outcome(int winner, mcts_reward reward[2])
+{
+    reward[0] = mcts_reward_for(winner, 0);
+    reward[1] = mcts_reward_for(winner, 1);
+}
+
+/* Evaluator's estimate of the reward to the player to move. */
+static float
+mcts_eval(const struct mcts *m, bitboard me, bitboard them)
+{
+    float sum = m->eval[EVAL_WEIGHTS - 1];
+    for (size_t i = 0; i < LINES_WIN; i++)
+        sum += m->eval[line_pattern(lines_win[i], me, them)];
+    for (size_t i = 0; i < LINES_LOSE; i++)
+        sum += m->eval[EVAL_WIN + line_pattern(lines_lose[i], me, them)];
+    return tanhf(sum);
+}
+
+/**
+ * Value a new leaf, reached by the given player's move, with a random
+ * playout, the evaluator, or a blend of both. A playout leaves its
+ * terminal position in state.
+ */
+static void
+mcts_leaf(struct mcts *m, bitboard state[2], int turn, mcts_reward reward[2])
+{
+    float mix = m->eval_mix;
+    float value = 0;  // to the player to move at the leaf
+    if (mix > 0)
+        value = mcts_eval(m, state[!turn], state[turn]);
+    if (mix < 1) {
+        mcts_outcome(mcts_playout_final(m->rng, state, turn), reward);
+        reward[!turn] = mix * value + (1 - mix) * reward[!turn];
+        reward[turn] = mix * -value + (1 - mix) * reward[turn];
+    } else {
+        reward[!turn] = value;
+        reward[turn] = -value;
+    }
+}
+
+/* Mean reward of move i at node n, to the player to move at n. */
+static double
+mcts_mean(const struct mcts *m, const struct mcts_node *n, int i)
+{
+#if YAVALATH_DAG
+    mcts_index child = n->next[i];
+    if (child < MCTS_LIMIT && m->nodes[child].visits)
+        return m->nodes[child].value / (double)m->nodes[child].visits;
+#else
+    (void)m;
+#endif
+    return n->reward[i] / (double)n->playouts[i];
+}
+
+#if YAVALATH_DAG
+/* Record a playout through a node on behalf of the player who moved
+ * into it, whichever parent it came from.
+ */
+static void
+mcts_visit(struct mcts_node *child, mcts_reward reward)
+{
+    child->visits++;
+    child->value += reward;
+}
+#endif
+
+#if YAVALATH_RAVE
 static int
-mcts_playout(struct mcts *m, uint32_t node, int turn)
+lowest_bit(bitboard x)
 {
-    if (node == MCTS_WIN0)
-        return 0;
-    else if (node == MCTS_WIN1)
-        return 1;
-    else if (node == MCTS_DRAW)
-        return DRAW;
-    assert(node != MCTS_NULL);
+#if defined(__GNUC__) && CELLS > 64
+    uint64_t lo = x;
+    return lo ? __builtin_ctzll(lo) : 64 + __builtin_ctzll(x >> 64);
+#elif defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int i = 0;
+    while (!((x >> i) & 1))
+        i++;
+    return i;
+#endif
+}
 
-    struct mcts_node *n = m->nodes + node;
-    if (n->total_playouts == UINT32_MAX)
-        return -2; // more playouts would overflow
-    int play = -1;
-    if (!n->unexplored) {
-        /* Use upper confidence bound (UCB1). */
-        uint64_t taken = n->state[0] | n->state[1];
-        float best_x = -INFINITY;
-        float numerator = YAVALATH_C * logf(n->total_playouts);
-        int best[61];
-        int nbest = 0;
-        for (int i = 0; i < 61; i++) {
-            if (!((taken >> i) & 1)) {
-                assert(n->playouts[i]);
-                float mean = n->reward[i] / n->playouts[i];
-                float x = mean + sqrtf(numerator / n->playouts[i]);
-                if (x > best_x) {
-                    best_x = x;
-                    nbest = 1;
-                    best[0] = i;
-                } else if (x == best_x) {
-                    best[nbest++] = i;
-                }
+/* Credit every cell the player at this node went on to take. */
+static void
+mcts_amaf_update(struct mcts_node *n, int turn, const bitboard final[2],
+                 mcts_reward reward)
+{
+    bitboard moves = final[turn] & ~(n->state[0] | n->state[1]);
+    for (; moves; moves &= moves - 1) {
+        int i = lowest_bit(moves);
+        n->amaf_playouts[i]++;
+        n->amaf_reward[i] += reward;
+    }
+}
+#endif
+
+/* Choose the move at a fully explored node by UCB1. */
+static int
+mcts_select(struct mcts *m, struct mcts_node *n)
+{
+    bitboard taken = n->state[0] | n->state[1];
+    mcts_reward best_x = -INFINITY;
+    mcts_reward numerator = YAVALATH_C * mcts_log(n->total_playouts);
+    int best[CELLS];
+    int nbest = 0;
+#if YAVALATH_DAG
+    /* Child values are read below, so start loading them all. */
+    for (int i = 0; i < CELLS; i++)
+        if (n->next[i] < MCTS_LIMIT)
+            PREFETCH(m->nodes + n->next[i]);
+#endif
+    for (int i = 0; i < CELLS; i++) {
+        if (!((taken >> i) & 1) && n->next[i] != MCTS_PRUNED) {
+            assert(n->playouts[i]);
+            mcts_reward mean = mcts_mean(m, n, i);
+#if YAVALATH_RAVE
+            if (n->amaf_playouts[i]) {
+                mcts_reward amaf = n->amaf_reward[i] / n->amaf_playouts[i];
+                mcts_reward beta = mcts_sqrt(YAVALATH_RAVE_K /
+                                             (3 * n->playouts[i] +
+                                              YAVALATH_RAVE_K));
+                mean = (1 - beta) * mean + beta * amaf;
+            }
+#endif
+            mcts_reward x = mean + mcts_sqrt(numerator / n->playouts[i]);
+            if (x > best_x) {
+                best_x = x;
+                nbest = 1;
+                best[0] = i;
+            } else if (x == best_x) {
+                best[nbest++] = i;
             }
         }
-        play = nbest == 1 ? best[0] : best[xoroshiro128plus(m->rng) % nbest];
-        int winner = mcts_playout(m, n->next[play], !turn);
-        if (winner >= 0) {
+    }
+    return nbest == 1 ? best[0] : best[xoroshiro128plus(m->rng) % nbest];
+}
+
+/* Hash bucket of the position after a move, loaded ahead of use. */
+static uint64_t
+mcts_child_hash(struct mcts *m, const struct mcts_node *n, int turn, int play)
+{
+    bitboard next_state[2] = {n->state[0], n->state[1]};
+    next_state[turn] |= BIT(play);
+    uint64_t hash = state_hash(next_state[0], next_state[1]);
+    PREFETCH(mcts_heads(m) + hash % m->nodes_avail);
+    return hash;
+}
+
+/**
+ * Take an unexplored move from a node and value the result, by the
+ * game's outcome or a new leaf. The terminal position is stored in
+ * final and the reward to each player in reward. Returns -1 when out
+ * of memory, and 0 otherwise.
+ */
+static int
+mcts_expand(struct mcts *m, struct mcts_node *n, int turn, int play,
+            bitboard final[2], mcts_reward reward[2])
+{
+    assert(play >= 0 && play < CELLS);
+    bitboard next_state[2] = {n->state[0], n->state[1]};
+    next_state[turn] |= BIT(play);
+    /* Start loading the hash bucket while checking the move. */
+    uint64_t hash = mcts_child_hash(m, n, turn, play);
+    bitboard dummy;
+    switch (check(next_state[turn], next_state[!turn], play, &dummy)) {
+        case YAVALATH_GAME_WIN:
             n->playouts[play]++;
             n->total_playouts++;
-        }
-        if (winner == turn)
             n->reward[play] += REWARD_WIN;
-        else if (winner == !turn)
+            n->next[play] = turn ? MCTS_WIN1 : MCTS_WIN0;
+            n->unexplored--;
+            mcts_outcome(turn, reward);
+            break;
+        case YAVALATH_GAME_LOSS:
+            n->playouts[play]++;
+            n->total_playouts++;
             n->reward[play] += REWARD_LOSS;
-        else if (winner == DRAW)
+            n->next[play] = turn ? MCTS_WIN0 : MCTS_WIN1;
+            n->unexplored--;
+            mcts_outcome(!turn, reward);
+            break;
+        case YAVALATH_GAME_DRAW:
+            n->playouts[play]++;
+            n->total_playouts++;
             n->reward[play] += REWARD_DRAW;
-        return winner;
-    } else {
+            n->next[play] = MCTS_DRAW;
+            n->unexplored--;
+            mcts_outcome(DRAW, reward); // neither
+            break;
+        case YAVALATH_GAME_UNRESOLVED:
+            n->next[play] = mcts_alloc_hashed(m, next_state, !turn, hash);
+            if (n->next[play] == MCTS_NULL)
+                return -1; // out of memory
+            n->unexplored--;
+            n->playouts[play]++;
+            n->total_playouts++;
+            /* Simulate remaining without allocation. */
+            mcts_leaf(m, next_state, turn, reward);
+            n->reward[play] += reward[turn];
+#if YAVALATH_DAG
+            mcts_visit(m->nodes + n->next[play], reward[turn]);
+#endif
+            break;
+    }
+    final[0] = next_state[0];
+    final[1] = next_state[1];
+#if YAVALATH_RAVE
+    mcts_amaf_update(n, turn, final, reward[turn]);
+#endif
+    return 0;
+}
+
+/* Outcome of a playout that reached a finished game. */
+static void
+mcts_terminal(mcts_index node, mcts_reward reward[2])
+{
+    assert(node != MCTS_NULL && node != MCTS_PRUNED);
+    if (node == MCTS_WIN0)
+        mcts_outcome(0, reward);
+    else if (node == MCTS_WIN1)
+        mcts_outcome(1, reward);
+    else
+        mcts_outcome(DRAW, reward);
+}
+
+/**
+ * Run one playout from the given node. The terminal position reached
+ * is stored in final, which the caller presets to the node's state,
+ * and the reward to each player in reward. Returns -1 when out of
+ * memory, -2 on counter overflow, and 0 otherwise.
+ */
+static int
+mcts_playout(struct mcts *m, mcts_index node, int turn, bitboard final[2],
+             mcts_reward reward[2])
+{
+    if (node >= MCTS_LIMIT) {
+        mcts_terminal(node, reward);
+        return 0;
+    }
+
+    struct mcts_node *n = m->nodes + node;
+    if (n->total_playouts == MCTS_COUNT_MAX)
+        return -2; // more playouts would overflow
+    if (n->unexplored) {
         /* Choose a random unplayed move. */
-        play = random_play_from_remaining(n, m->rng);
-        assert(play >= 0 && play <= 61);
-        uint64_t next_state[2] = {n->state[0], n->state[1]};
-        next_state[turn] |= UINT64_C(1) << play;
-        uint64_t dummy;
-        switch (check(next_state[turn], next_state[!turn], play, &dummy)) {
-            case YAVALATH_GAME_WIN:
-                n->playouts[play]++;
-                n->total_playouts++;
-                n->reward[play] += REWARD_WIN;
-                n->next[play] = turn ? MCTS_WIN1 : MCTS_WIN0;
-                n->unexplored--;
-                return turn;
-            case YAVALATH_GAME_LOSS:
-                n->playouts[play]++;
-                n->total_playouts++;
-                n->reward[play] += REWARD_LOSS;
-                n->next[play] = turn ? MCTS_WIN0 : MCTS_WIN1;
-                n->unexplored--;
-                return !turn;
-            case YAVALATH_GAME_DRAW:
-                n->playouts[play]++;
-                n->total_playouts++;
-                n->reward[play] += REWARD_DRAW;
-                n->next[play] = MCTS_DRAW;
-                n->unexplored--;
-                return DRAW; // neither
-            case YAVALATH_GAME_UNRESOLVED:
-                n->next[play] = mcts_alloc(m, next_state);
-                if (n->next[play] == MCTS_NULL)
-                    return -1; // out of memory
-                n->unexplored--;
-                n->playouts[play]++;
-                n->total_playouts++;
-                break;
+        int play = random_play_from_remaining(n, m->rng);
+        return mcts_expand(m, n, turn, play, final, reward);
+    }
+
+    /* Use upper confidence bound (UCB1). */
+    int play = mcts_select(m, n);
+    if (n->next[play] < MCTS_LIMIT)
+        mcts_prefetch(m->nodes + n->next[play]);
+    final[turn] |= BIT(play);
+    int r = mcts_playout(m, n->next[play], !turn, final, reward);
+    if (r >= 0) {
+        n->playouts[play]++;
+        n->total_playouts++;
+        n->reward[play] += reward[turn];
+#if YAVALATH_DAG
+        if (n->next[play] < MCTS_LIMIT)
+            mcts_visit(m->nodes + n->next[play], reward[turn]);
+#endif
+#if YAVALATH_RAVE
+        mcts_amaf_update(n, turn, final, reward[turn]);
+#endif
+    }
+    return r;
+}
+
+/* Interleaved playouts: a single thread keeps several descents in
+ * flight, each one a small state machine. A step does the work at one
+ * node and prefetches what the next step of that descent needs, then
+ * yields to the next descent, so the cache misses of one descent are
+ * served while the others work. A move taken by a descent in flight
+ * is counted as played and lost (a virtual loss), steering the others
+ * away until the real result replaces it.
+ */
+struct descent {
+    mcts_index node;              // node or sentinel to visit next
+    int turn;                     // player to move there
+    int depth;                    // moves taken so far
+    int play;                     // move awaiting expansion, or -1
+    bitboard final[2];            // position reached so far
+    mcts_index path[CELLS];       // node each move was taken from
+    uint8_t plays[CELLS];
+};
+
+static void
+descent_start(struct mcts *m, struct descent *d)
+{
+    d->node = m->root;
+    d->turn = m->root_turn;
+    d->depth = 0;
+    d->play = -1;
+    d->final[0] = m->nodes[m->root].state[0];
+    d->final[1] = m->nodes[m->root].state[1];
+}
+
+/* Replace the virtual losses along a descent's path with its rewards,
+ * or with no rewards simply withdraw them.
+ */
+static void
+descent_finish(struct mcts *m, struct descent *d, const mcts_reward *reward)
+{
+    for (int k = d->depth - 1; k >= 0; k--) {
+        struct mcts_node *n = m->nodes + d->path[k];
+        int play = d->plays[k];
+        int turn = m->root_turn ^ (k & 1);
+        mcts_reward r = reward ? reward[turn] - REWARD_LOSS : -REWARD_LOSS;
+        n->reward[play] += r;
+        if (!reward) {
+            n->playouts[play]--;
+            n->total_playouts--;
         }
-        /* Simulate remaining without allocation. */
-        int winner = mcts_playout_final(m->rng, next_state, turn);
-        if (winner == turn)
-            n->reward[play] += REWARD_WIN;
-        else if (winner == !turn)
-            n->reward[play] += REWARD_LOSS;
-        else if (winner == DRAW)
-            n->reward[play] += REWARD_DRAW;
-        return winner;
+#if YAVALATH_DAG
+        mcts_index child = n->next[play];
+        if (child < MCTS_LIMIT) {
+            m->nodes[child].value += r;
+            m->nodes[child].visits -= !reward;
+        }
+#endif
+#if YAVALATH_RAVE
+        if (reward)
+            mcts_amaf_update(n, turn, d->final, reward[turn]);
+#endif
+    }
+}
+
+/**
+ * Take one step of a descent. Returns 1 once its playout is complete
+ * and recorded, 0 while it is still in flight, and like mcts_playout()
+ * -1 when out of memory and -2 on counter overflow.
+ */
+static int
+descent_step(struct mcts *m, struct descent *d)
+{
+    mcts_reward reward[2];
+    if (d->node >= MCTS_LIMIT) {
+        mcts_terminal(d->node, reward);
+        descent_finish(m, d, reward);
+        return 1;
+    }
+
+    struct mcts_node *n = m->nodes + d->node;
+    int turn = d->turn;
+    if (d->play >= 0) {
+        int play = d->play;
+        d->play = -1;
+        if (n->next[play] == MCTS_NULL) {
+            if (mcts_expand(m, n, turn, play, d->final, reward))
+                return -1;
+            descent_finish(m, d, reward);
+            return 1;
+        }
+        /* Another descent expanded it meanwhile, so choose again. */
     }
+    if (n->total_playouts == MCTS_COUNT_MAX)
+        return -2;
+    if (n->unexplored) {
+        /* Expand on the next step, once the hash bucket is loaded. */
+        d->play = random_play_from_remaining(n, m->rng);
+        mcts_child_hash(m, n, turn, d->play);
+        return 0;
+    }
+
+    int play = mcts_select(m, n);
+    n->playouts[play]++;
+    n->total_playouts++;
+    n->reward[play] += REWARD_LOSS;
+    mcts_index child = n->next[play];
+#if YAVALATH_DAG
+    if (child < MCTS_LIMIT)
+        mcts_visit(m->nodes + child, REWARD_LOSS);
+#endif
+    d->path[d->depth] = d->node;
+    d->plays[d->depth++] = play;
+    d->final[turn] |= BIT(play);
+    d->node = child;
+    d->turn = !turn;
+    if (child < MCTS_LIMIT)
+        mcts_prefetch(m->nodes + child);
+    return 0;
+}
+
+/**
+ * Run count playouts from the root with up to m->inflight descents
+ * interleaved, stopping early when stop is set. The number completed
+ * is stored in done. Returns like mcts_playout(), and on failure
+ * withdraws every descent still in flight.
+ */
+static int
+mcts_playout_group(struct mcts *m, uint32_t count, volatile int *stop,
+                   uint32_t *done)
+{
+    struct descent d[YAVALATH_INFLIGHT_MAX];
+    int active = 0;
+    uint32_t started = 0;
+    *done = 0;
+    for (; active < m->inflight && started < count; active++, started++)
+        descent_start(m, d + active);
+    while (active) {
+        for (int i = 0; i < active; i++) {
+            int r = descent_step(m, d + i);
+            if (r < 0) {
+                for (int j = 0; j < active; j++)
+                    descent_finish(m, d + j, 0);
+                return r;
+            } else if (r) {
+                ++*done;
+                if (started < count && !(stop && *stop)) {
+                    descent_start(m, d + i);
+                    started++;
+                } else {
+                    d[i--] = d[--active];
+                }
+            }
+        }
+    }
+    return 0;
 }
 
 /* API */
@@ -443,50 +1271,236 @@ yavalath_bit_to_notation(char *notation, int bit)
 }
 
 enum yavalath_game_result
-yavalath_check(uint64_t  who,
-               uint64_t  opponent,
-               int       bit,
-               uint64_t *where)
+yavalath_check(yavalath_bitboard  who,
+               yavalath_bitboard  opponent,
+               int                bit,
+               yavalath_bitboard *where)
 {
-    uint64_t dummy;
+    bitboard dummy;
     if (!where)
         where = &dummy;
     return check(who, opponent, bit, where);
 }
 
-enum yavalath_result
-yavalath_ai_init(void    *buf,
-                 size_t   bufsize,
-                 uint64_t player0,
-                 uint64_t player1,
-                 uint64_t seed)
+void
+yavalath_eval_features(yavalath_bitboard who,
+                       yavalath_bitboard opponent,
+                       float            *features)
+{
+    for (int i = 0; i < EVAL_WEIGHTS; i++)
+        features[i] = 0;
+    for (size_t i = 0; i < LINES_WIN; i++)
+        features[line_pattern(lines_win[i], who, opponent)]++;
+    for (size_t i = 0; i < LINES_LOSE; i++)
+        features[EVAL_WIN + line_pattern(lines_lose[i], who, opponent)]++;
+    features[EVAL_WEIGHTS - 1] = 1;
+}
+
+static enum yavalath_result
+ai_init(void *buf,
+        size_t bufsize,
+        bitboard player0,
+        bitboard player1,
+        uint64_t seed,
+        int zeroed)
 {
-    uint64_t state[2] = {player0, player1};
+    bitboard state[2] = {player0, player1};
     if (player0 & player1)
         return YAVALATH_INVALID_ARGUMENT;
-    if (player0 & UINT64_C(0xe000000000000000))
+    if (player0 & ~FULL)
+        return YAVALATH_INVALID_ARGUMENT;
+    if (player1 & ~FULL)
+        return YAVALATH_INVALID_ARGUMENT;
+    if (mcts_init(buf, bufsize, state, 0, seed, zeroed))
+        return YAVALATH_SUCCESS;
+    return YAVALATH_INVALID_ARGUMENT;
+}
+
+enum yavalath_result
+yavalath_ai_init(void              *buf,
+                 size_t             bufsize,
+                 yavalath_bitboard  player0,
+                 yavalath_bitboard  player1,
+                 uint64_t           seed)
+{
+    return ai_init(buf, bufsize, player0, player1, seed, 0);
+}
+
+enum yavalath_result
+yavalath_ai_init_zeroed(void              *buf,
+                        size_t             bufsize,
+                        yavalath_bitboard  player0,
+                        yavalath_bitboard  player1,
+                        uint64_t           seed)
+{
+    return ai_init(buf, bufsize, player0, player1, seed, 1);
+}
+
+enum yavalath_result
+yavalath_ai_set_evaluator(void *buf, const float *weights, float mix)
+{
+    struct mcts *m = buf;
+    if (!(mix >= 0 && mix <= 1))
+        return YAVALATH_INVALID_ARGUMENT;
+    if (weights)
+        memcpy(m->eval, weights, sizeof(m->eval));
+    else if (mix > 0)
+        return YAVALATH_INVALID_ARGUMENT;
+    m->eval_mix = mix;
+    return YAVALATH_SUCCESS;
+}
+
+enum yavalath_result
+yavalath_ai_set_inflight(void *buf, int inflight)
+{
+    struct mcts *m = buf;
+    if (inflight < 1 || inflight > YAVALATH_INFLIGHT_MAX)
+        return YAVALATH_INVALID_ARGUMENT;
+    m->inflight = inflight;
+    return YAVALATH_SUCCESS;
+}
+
+enum yavalath_result
+yavalath_cache_init(void *cache, size_t size)
+{
+#if YAVALATH_CACHE
+    struct cache *c = cache;
+    if (size < sizeof(*c) + sizeof(c->entries[0]) * CACHE_BUCKET)
         return YAVALATH_INVALID_ARGUMENT;
-    if (player1 & UINT64_C(0xe000000000000000))
+    /* Zero-filled memory is an empty table, so only the magic needs
+     * setting, and the first process to attach sets it.
+     */
+    uint64_t expect = 0;
+    if (__atomic_compare_exchange_n(&c->magic, &expect, CACHE_MAGIC, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return YAVALATH_SUCCESS;
+    return expect == CACHE_MAGIC ? YAVALATH_SUCCESS
+                                 : YAVALATH_INVALID_ARGUMENT;
+#else
+    (void)cache;
+    (void)size;
+    return YAVALATH_INVALID_ARGUMENT;
+#endif
+}
+
+enum yavalath_result
+yavalath_ai_set_cache(void *buf, void *cache, size_t size, uint32_t prior)
+{
+    struct mcts *m = buf;
+    if (!cache) {
+        m->cache = NULL;
+        return YAVALATH_SUCCESS;
+    }
+#if YAVALATH_CACHE
+    struct cache *c = cache;
+    if (size < sizeof(*c) + sizeof(c->entries[0]) * CACHE_BUCKET ||
+        __atomic_load_n(&c->magic, __ATOMIC_ACQUIRE) != CACHE_MAGIC)
         return YAVALATH_INVALID_ARGUMENT;
-    if (mcts_init(buf, bufsize, state, 0, seed))
+    m->cache = c;
+    m->cache_entries = (size - sizeof(*c)) / sizeof(c->entries[0]);
+    m->cache_prior = prior;
+
+    /* The root was allocated before the cache was attached. */
+    struct mcts_node *root = m->nodes + m->root;
+    if (!root->total_playouts)
+        mcts_seed(m, root, m->root_turn,
+                  state_hash(root->state[0], root->state[1]));
+    return YAVALATH_SUCCESS;
+#else
+    (void)size;
+    (void)prior;
+    return YAVALATH_INVALID_ARGUMENT;
+#endif
+}
+
+enum yavalath_result
+yavalath_ai_resize(void *buf, size_t newsize)
+{
+    if (mcts_resize(buf, newsize))
         return YAVALATH_SUCCESS;
     return YAVALATH_INVALID_ARGUMENT;
 }
 
+void
+yavalath_ai_compact(void *buf)
+{
+    mcts_compact(buf);
+}
+
 enum yavalath_result
 yavalath_ai_advance(void *buf, int bit)
 {
-    if (mcts_advance(buf, bit))
+    if (bit >= 0 && bit < CELLS && mcts_advance(buf, bit))
         return YAVALATH_SUCCESS;
     return YAVALATH_INVALID_ARGUMENT;
 }
 
+/* The root move with the best mean, ties going to more playouts. */
+static int
+mcts_best(const struct mcts *m, double *score)
+{
+    const struct mcts_node *n = m->nodes + m->root;
+    bitboard taken = n->state[0] | n->state[1];
+    int best = -1;
+    *score = 0;
+    for (int i = 0; i < CELLS; i++) {
+        if (!((taken >> i) & 1) && n->playouts[i]) {
+            double mean = mcts_mean(m, n, i);
+            if (best == -1 || mean > *score ||
+                (mean == *score && n->playouts[i] > n->playouts[best])) {
+                best = i;
+                *score = mean;
+            }
+        }
+    }
+    return best;
+}
+
 enum yavalath_result
 yavalath_ai_playout(void *buf, uint32_t num_playouts)
+{
+    return yavalath_ai_search(buf, num_playouts, 0, 0, 0, 0);
+}
+
+enum yavalath_result
+yavalath_ai_search(void                *buf,
+                   uint32_t             num_playouts,
+                   uint32_t             interval,
+                   yavalath_progress_fn callback,
+                   void                *arg,
+                   volatile int        *stop)
 {
     struct mcts *m = buf;
-    for (uint32_t i = 0; i < num_playouts; i++) {
-        int r = mcts_playout(m, m->root, m->root_turn);
+    uint32_t next_report = callback && interval ? interval : UINT32_MAX;
+    for (uint32_t i = 0; i < num_playouts;) {
+        if (stop && *stop)
+            return YAVALATH_STOPPED;
+        if (i == next_report) {
+            struct yavalath_progress p;
+            p.best_move = mcts_best(m, &p.score);
+            p.playouts = i;
+            p.total_playouts = m->nodes[m->root].total_playouts;
+            p.nodes_used = m->nodes_allocated;
+            p.nodes_total = m->nodes_avail;
+            next_report += interval;
+            if (callback(&p, arg))
+                return YAVALATH_STOPPED;
+        }
+        int r;
+        if (m->inflight > 1) {
+            uint32_t end = num_playouts < next_report ? num_playouts
+                                                      : next_report;
+            uint32_t done;
+            r = mcts_playout_group(m, end - i, stop, &done);
+            i += done;
+        } else {
+            bitboard final[2] = {
+                m->nodes[m->root].state[0], m->nodes[m->root].state[1]
+            };
+            mcts_reward reward[2];
+            r = mcts_playout(m, m->root, m->root_turn, final, reward);
+            i++;
+        }
         if (r == -1)
             return YAVALATH_BAILOUT_MEMORY;
         else if (r == -2)
@@ -495,18 +1509,130 @@ yavalath_ai_playout(void *buf, uint32_t num_playouts)
     return YAVALATH_SUCCESS;
 }
 
+/* Time management, which so far plays no stronger than an equal
+ * fixed time per move. A game is planned to end by the time this many
+ * cells are left empty, with at least a few moves to spare. Most games
+ * are decided well before the board fills, so each of our moves is
+ * counted as using up several cells. A little of the clock is always
+ * held back.
+ */
+#define TIMER_HORIZON   20
+#define TIMER_CELLS     6     // empty cells per move of ours
+#define TIMER_MOVES_MIN 3
+#define TIMER_RESERVE   50    // msecs
+
+void
+yavalath_timer_start(struct yavalath_timer *timer,
+                     const void            *buf,
+                     uint64_t               remaining,
+                     uint64_t               increment)
+{
+    const struct mcts *m = buf;
+    const struct mcts_node *n = m->nodes + m->root;
+    bitboard taken = n->state[0] | n->state[1];
+    int empty = 0;
+    int choices = 0;
+    for (int i = 0; i < CELLS; i++) {
+        if (!((taken >> i) & 1)) {
+            empty++;
+            choices += n->next[i] != MCTS_PRUNED;
+        }
+    }
+    int moves = TIMER_MOVES_MIN;
+    if (empty > TIMER_HORIZON)
+        moves += (empty - TIMER_HORIZON) / TIMER_CELLS;
+    uint64_t usable = remaining > TIMER_RESERVE ? remaining - TIMER_RESERVE
+                                                : 0;
+    uint64_t bonus = increment / 4 * 3;
+    uint64_t target = usable / moves + bonus;
+    uint64_t limit = usable / 3 + bonus;
+    if (limit > target * 3)
+        limit = target * 3;
+    if (limit > usable)
+        limit = usable;
+    timer->target = target < limit ? target : limit;
+    timer->limit = limit;
+    timer->playouts = n->total_playouts;
+    timer->reference = 0;
+    timer->referenced = 0;
+    timer->forced = choices <= 1;
+}
+
+int
+yavalath_timer_check(struct yavalath_timer *timer,
+                     const void            *buf,
+                     uint64_t               elapsed)
+{
+    const struct mcts *m = buf;
+    const struct mcts_node *n = m->nodes + m->root;
+    double score;
+    int best = mcts_best(m, &score);
+    if (best == -1)
+        return 0;  // always search enough to pick a move
+    if (timer->forced || elapsed >= timer->limit)
+        return 1;
+    mcts_index win = m->root_turn ? MCTS_WIN1 : MCTS_WIN0;
+    if (n->next[best] == win)
+        return 1;  // nothing to think about
+    if (!timer->referenced && elapsed >= timer->target / 4) {
+        timer->reference = score;
+        timer->referenced = 1;
+    }
+
+    /* The two most visited moves. */
+    bitboard taken = n->state[0] | n->state[1];
+    mcts_count first = 0;
+    mcts_count second = 0;
+    int most = -1;
+    for (int i = 0; i < CELLS; i++) {
+        if ((taken >> i) & 1)
+            continue;
+        if (n->playouts[i] > first) {
+            second = first;
+            first = n->playouts[i];
+            most = i;
+        } else if (n->playouts[i] > second) {
+            second = n->playouts[i];
+        }
+    }
+
+    /* Scale the target by how settled the search looks: down when
+     * visits pile onto one move, up when the score has dropped.
+     */
+    double share = first / (double)n->total_playouts;
+    double scale = 1.5 - share;
+    if (scale < 0.4)
+        scale = 0.4;
+    if (timer->referenced && score < timer->reference - 0.1)
+        scale *= 1.5;
+    double target = timer->target * scale;
+    if (target > timer->limit)
+        target = timer->limit;
+    if (elapsed >= target)
+        return 1;
+
+    /* Stop once the runner-up cannot catch up in the time left. */
+    uint64_t done = n->total_playouts - timer->playouts;
+    if (most == best && elapsed && done) {
+        double left = done * ((target - elapsed) / elapsed);
+        if (first - second > left)
+            return 1;
+    }
+    return 0;
+}
+
 int
 yavalath_ai_best_move(void *buf)
 {
     struct mcts *m = buf;
     struct mcts_node *n = m->nodes + m->root;
-    uint64_t taken = n->state[0] | n->state[1];
+    bitboard taken = n->state[0] | n->state[1];
     double best_ratio = -INFINITY;
-    int best[61];
+    int best[CELLS];
     int nbest = 0;
-    for (int i = 0; i < 61; i++) {
+    for (int i = 0; i < CELLS; i++) {
         if (!((taken >> i) & 1) && n->playouts[i]) {
-            double ratio = n->reward[i] / (double)n->playouts[i];
+            double ratio = mcts_mean(m, n, i);
             if (ratio > best_ratio) {
                 nbest = 1;
                 best[0] = i;
@@ -524,27 +1650,230 @@ yavalath_ai_get_move_score(const void *buf, int bit)
 {
     const struct mcts *m = buf;
     const struct mcts_node *n = m->nodes + m->root;
-    uint64_t taken = n->state[0] | n->state[1];
+    bitboard taken = n->state[0] | n->state[1];
     if (!((taken >> bit) & 1) && n->playouts[bit])
-        return n->reward[bit] / (double)n->playouts[bit];
+        return mcts_mean(m, n, bit);
+    return 0;
+}
+
+uint64_t
+yavalath_ai_get_move_playouts(const void *buf, int bit)
+{
+    const struct mcts *m = buf;
+    const struct mcts_node *n = m->nodes + m->root;
+    bitboard taken = n->state[0] | n->state[1];
+    if (!((taken >> bit) & 1))
+        return n->playouts[bit];
     return 0;
 }
 
-uint32_t
+int
+yavalath_ai_get_pv(const void *buf, int *moves, int maxlen)
+{
+    const struct mcts *m = buf;
+    mcts_index node = m->root;
+    int len = 0;
+    while (node < MCTS_LIMIT && len < maxlen) {
+        const struct mcts_node *n = m->nodes + node;
+        int best = -1;
+        for (int i = 0; i < CELLS; i++)
+            if (n->playouts[i] && (best == -1 ||
+                                   n->playouts[i] > n->playouts[best]))
+                best = i;
+        if (best == -1)
+            break;
+        moves[len++] = best;
+        node = n->next[best];
+    }
+    return len;
+}
+
+#define DUMP_WORDS ((CELLS + 63) / 64)
+#define DUMP_NODE  (4 + 8 + 8 + DUMP_WORDS * 2 * 8)
+#define DUMP_EDGE  (1 + 1 + 8 + 8 + 8)
+
+static unsigned char *
+put64(unsigned char *p, uint64_t x)
+{
+    for (int i = 0; i < 8; i++)
+        *p++ = x >> (i * 8);
+    return p;
+}
+
+static unsigned char *
+put_bitboard(unsigned char *p, bitboard x)
+{
+#if CELLS > 64
+    p = put64(p, x);
+    return put64(p, x >> 64);
+#else
+    return put64(p, x);
+#endif
+}
+
+static int
+dump_node(const struct mcts *m, mcts_index node, int depth, int turn,
+          yavalath_write_fn write, void *arg)
+{
+    unsigned char record[DUMP_NODE + DUMP_EDGE * CELLS];
+    const struct mcts_node *n = m->nodes + node;
+    unsigned char *p = record + 4;
+    int nedges = 0;
+    p = put64(p, node);
+    p = put64(p, n->total_playouts);
+    p = put_bitboard(p, n->state[0]);
+    p = put_bitboard(p, n->state[1]);
+    for (int i = 0; i < CELLS; i++) {
+        if (!n->playouts[i])
+            continue;
+        mcts_index child = n->next[i];
+        double reward = n->reward[i];
+        uint64_t bits;
+        memcpy(&bits, &reward, sizeof(bits));
+        *p++ = i;
+        *p++ = child == MCTS_WIN0 ? 1 :
+               child == MCTS_WIN1 ? 2 :
+               child == MCTS_DRAW ? 3 : 0;
+        p = put64(p, n->playouts[i]);
+        p = put64(p, bits);
+        p = put64(p, child < MCTS_LIMIT ? child : 0);
+        nedges++;
+    }
+    record[0] = depth;
+    record[1] = turn;
+    record[2] = nedges;
+    record[3] = 0;
+    return write(record, p - record, arg);
+}
+
+enum yavalath_result
+yavalath_ai_dump(const void        *buf,
+                 int                max_depth,
+                 uint64_t           min_playouts,
+                 yavalath_write_fn  write,
+                 void              *arg)
+{
+    const struct mcts *m = buf;
+    unsigned char header[8] = {'Y', 'A', 'V', 'T', 1, CELLS, m->root_turn};
+    if (write(header, sizeof(header), arg))
+        return YAVALATH_STOPPED;
+    if (max_depth > CELLS)
+        max_depth = CELLS;
+
+    /* Depth-first walk with an explicit stack of resume points. */
+    struct {
+        mcts_index node;
+        int next;
+    } stack[CELLS + 1];
+    int depth = 0;
+    stack[0].node = m->root;
+    stack[0].next = 0;
+    if (dump_node(m, m->root, 0, m->root_turn, write, arg))
+        return YAVALATH_STOPPED;
+    while (depth >= 0) {
+        const struct mcts_node *n = m->nodes + stack[depth].node;
+        int i = stack[depth].next;
+        if (depth < max_depth)
+            for (; i < CELLS; i++)
+                if (n->next[i] < MCTS_LIMIT && n->playouts[i] &&
+                    n->playouts[i] >= min_playouts)
+                    break;
+        if (depth >= max_depth || i == CELLS) {
+            depth--;
+            continue;
+        }
+        stack[depth].next = i + 1;
+        stack[++depth].node = n->next[i];
+        stack[depth].next = 0;
+        int turn = m->root_turn ^ (depth & 1);
+        if (dump_node(m, n->next[i], depth, turn, write, arg))
+            return YAVALATH_STOPPED;
+    }
+    return YAVALATH_SUCCESS;
+}
+
+#if YAVALATH_CACHE
+static void
+publish_node(const struct mcts *m, const struct mcts_node *n, int turn)
+{
+    struct cache_entry e;
+    memset(&e, 0, sizeof(e));
+    e.state[0] = n->state[0];
+    e.state[1] = n->state[1];
+    e.turn = turn;
+    for (int i = 0; i < CELLS; i++) {
+        if (n->playouts[i]) {
+            e.playouts[i] = n->playouts[i] < UINT32_MAX ? n->playouts[i]
+                                                        : UINT32_MAX;
+            e.mean[i] = mcts_mean(m, n, i);
+            e.total = e.total + e.playouts[i] < e.total ?
+                      UINT32_MAX : e.total + e.playouts[i];
+        }
+    }
+    uint64_t hash = state_hash(n->state[0], n->state[1]);
+    cache_store(m->cache, m->cache_entries, hash, &e);
+}
+#endif
+
+uint64_t
+yavalath_ai_publish(const void *buf, uint64_t min_playouts)
+{
+    const struct mcts *m = buf;
+    uint64_t count = 0;
+#if YAVALATH_CACHE
+    if (!m->cache || m->nodes[m->root].total_playouts < min_playouts)
+        return 0;
+
+    /* Depth-first walk, as in yavalath_ai_dump(). */
+    struct {
+        mcts_index node;
+        int next;
+    } stack[CELLS + 1];
+    int depth = 0;
+    stack[0].node = m->root;
+    stack[0].next = 0;
+    publish_node(m, m->nodes + m->root, m->root_turn);
+    count++;
+    while (depth >= 0) {
+        const struct mcts_node *n = m->nodes + stack[depth].node;
+        int i = stack[depth].next;
+        for (; i < CELLS; i++)
+            if (n->next[i] < MCTS_LIMIT &&
+                m->nodes[n->next[i]].total_playouts >= min_playouts &&
+                n->playouts[i] >= min_playouts)
+                break;
+        if (i == CELLS) {
+            depth--;
+            continue;
+        }
+        stack[depth].next = i + 1;
+        stack[++depth].node = n->next[i];
+        stack[depth].next = 0;
+        publish_node(m, m->nodes + n->next[i], m->root_turn ^ (depth & 1));
+        count++;
+    }
+#else
+    (void)m;
+    (void)min_playouts;
+#endif
+    return count;
+}
+
+uint64_t
 yavalath_ai_get_nodes_total(const void *buf)
 {
     const struct mcts *m = buf;
     return m->nodes_avail;
 }
 
-uint32_t
+uint64_t
 yavalath_ai_get_nodes_used(const void *buf)
 {
     const struct mcts *m = buf;
     return m->nodes_allocated;
 }
 
-uint32_t
+uint64_t
 yavalath_ai_get_total_playouts(const void *buf)
 {
     const struct mcts *m = buf;